@@ -0,0 +1,121 @@
+#include "AffineTransform.h"
+
+#include <math.h>
+#include <string.h>
+
+AffineTransform::AffineTransform()
+{
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) m[i][j] = (i == j) ? 1.0F : 0.0F;
+        t[i] = 0;
+    }
+}
+
+AffineTransform AffineTransform::translation(float x, float y, float z)
+{
+    AffineTransform a;
+    a.t[0] = x;
+    a.t[1] = y;
+    a.t[2] = z;
+    return a;
+}
+
+AffineTransform AffineTransform::skew(float xy, float xz, float yz)
+{
+    AffineTransform a;
+    a.m[0][1] = -xy;
+    a.m[0][2] = -xz;
+    a.m[1][2] = -yz;
+    return a;
+}
+
+AffineTransform AffineTransform::then(const AffineTransform &next) const
+{
+    // next.m * (m * p + t) + next.t
+    AffineTransform a;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            a.m[i][j] = 0;
+            for (int k = 0; k < 3; k++) a.m[i][j] += next.m[i][k] * m[k][j];
+        }
+        a.t[i] = next.t[i];
+        for (int k = 0; k < 3; k++) a.t[i] += next.m[i][k] * t[k];
+    }
+    return a;
+}
+
+AffineTransform AffineTransform::inverse() const
+{
+    AffineTransform a;
+    // adjugate over determinant, only ever done when the offsets change
+    float det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+              - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+              + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    if(fabsf(det) < 1e-6F) return a; // can't happen with sane skew factors
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            int i1 = (j + 1) % 3, i2 = (j + 2) % 3, j1 = (i + 1) % 3, j2 = (i + 2) % 3;
+            a.m[i][j] = (m[i1][j1] * m[i2][j2] - m[i1][j2] * m[i2][j1]) / det;
+        }
+    }
+    // p = minv * (p' - t)
+    for (int i = 0; i < 3; i++) {
+        a.t[i] = 0;
+        for (int k = 0; k < 3; k++) a.t[i] -= a.m[i][k] * t[k];
+    }
+    return a;
+}
+
+void AffineTransform::apply(const float in[3], float out[3]) const
+{
+    float r[3];
+    for (int i = 0; i < 3; i++) {
+        r[i] = m[i][0] * in[0] + m[i][1] * in[1] + m[i][2] * in[2] + t[i];
+    }
+    memcpy(out, r, sizeof(r));
+}
+
+void AffineTransform::apply_linear(const float in[3], float out[3]) const
+{
+    float r[3];
+    for (int i = 0; i < 3; i++) {
+        r[i] = m[i][0] * in[0] + m[i][1] * in[1] + m[i][2] * in[2];
+    }
+    memcpy(out, r, sizeof(r));
+}
+
+void AffineTransform::move_target(const float pos[3], const float from[3], const float current[3], float target[3]) const
+{
+    if(is_identity_linear()) {
+        // the usual case, no need for the inverse
+        for (int i = 0; i < 3; i++) {
+            target[i] = isnan(pos[i]) ? current[i] : pos[i] + t[i];
+        }
+        return;
+    }
+
+    // where we are now in the source space, with the axes given replaced
+    float p[3];
+    for (int i = 0; i < 3; i++) {
+        p[i] = isnan(pos[i]) ? from[i] : pos[i];
+    }
+
+    for (int i = 0; i < 3; i++) {
+        bool moved = false;
+        for (int j = 0; j < 3; j++) {
+            if(!isnan(pos[j]) && m[i][j] != 0.0F) moved = true;
+        }
+        target[i] = moved ? m[i][0] * p[0] + m[i][1] * p[1] + m[i][2] * p[2] + t[i] : current[i];
+    }
+}
+
+bool AffineTransform::is_identity_linear() const
+{
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            if(m[i][j] != ((i == j) ? 1.0F : 0.0F)) return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,35 @@
+#ifndef _AFFINETRANSFORM_H
+#define _AFFINETRANSFORM_H
+
+// A 3D affine transform p' = m * p + t, used to take a work coordinate all the way to a machine coordinate in one go.
+// The offsets (WCS, G92, tool) are t and the axis skew correction is m
+class AffineTransform
+{
+public:
+    AffineTransform(); // identity
+
+    static AffineTransform translation(float x, float y, float z);
+    // factors are the tangent of the error in the angle between the two axes, the correction moves X by -xy * Y etc
+    static AffineTransform skew(float xy, float xz, float yz);
+
+    // this transform followed by next
+    AffineTransform then(const AffineTransform &next) const;
+    AffineTransform inverse() const;
+
+    void apply(const float in[3], float out[3]) const;
+    // just m, for relative moves
+    void apply_linear(const float in[3], float out[3]) const;
+
+    // the target for a move to pos (in the space this transforms from) from current (in the space it transforms to), from is
+    // current in the space this transforms from. Axes that are NAN in pos are not moved, and target axes that don't depend on
+    // any of the axes moved keep their current value exactly, so they don't pick up rounding errors
+    void move_target(const float pos[3], const float from[3], const float current[3], float target[3]) const;
+
+    bool is_identity_linear() const;
+
+private:
+    float m[3][3];
+    float t[3];
+};
+
+#endif /* _AFFINETRANSFORM_H */
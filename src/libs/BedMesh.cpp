@@ -0,0 +1,460 @@
+#include "BedMesh.h"
+#include "MemoryPool.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+// Catmull-Rom basis, p(t) = [1 t t² t³] * M/2 * [p-1 p0 p1 p2]
+static const float catmull_rom[4][4] = {
+    {  0,  2,  0,  0 },
+    { -1,  0,  1,  0 },
+    {  2, -5,  4, -1 },
+    { -1,  3, -3,  1 },
+};
+
+#define MESH_FILE_MAGIC   0x4853454DUL // "MESH"
+#define MESH_FILE_VERSION 1
+#define SECTOR_SIZE       512
+
+// the start of a mesh file, followed by the heights as int16 in rows of nx
+struct mesh_file_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;       // so later versions can add to it
+    uint16_t nx, ny;
+    float x0, y0, x1, y1;
+    float height_scale;
+    float z_offset;
+    uint32_t payload_size;      // bytes of heights after the header
+    uint32_t crc;               // CRC32 of the header, with this zero, and the heights
+};
+
+// CRC32 (the zip one) a nibble at a time, the table is small and this only runs on save and load
+static uint32_t crc32(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    crc= ~crc;
+    for (uint32_t i = 0; i < len; ++i) {
+        crc= (crc >> 4) ^ table[(crc ^ buf[i]) & 0x0F];
+        crc= (crc >> 4) ^ table[(crc ^ (buf[i] >> 4)) & 0x0F];
+    }
+    return ~crc;
+}
+
+// fraction along a line where it next crosses one of the n grid lines p0 + i*spacing after fraction t, 1 if it doesn't
+static float next_grid_line(float p, float d, float t, float p0, float spacing, float inv_spacing, int n)
+{
+    if(fabsf(d) < 0.000001F) return 1.0F;
+
+    // step a hair past the line we may be sitting on
+    float g= (p + d * t - p0) * inv_spacing;
+    int i;
+    if(d > 0) {
+        i= floorf(g + 0.0001F) + 1;
+        if(i < 0) i= 0;
+        if(i >= n) return 1.0F;
+    } else {
+        i= ceilf(g - 0.0001F) - 1;
+        if(i >= n) i= n - 1;
+        if(i < 0) return 1.0F;
+    }
+
+    float tc= (p0 + i * spacing - p) / d;
+    return (tc > 1.0F) ? 1.0F : tc;
+}
+
+BedMesh::BedMesh(MemoryPool &pool) : pool(pool)
+{
+    heights= nullptr;
+    coeff= nullptr;
+    height_scale= coeff_scale= 0.001F;
+    nx= ny= 0;
+    bicubic= false;
+    extrapolate= false;
+    set_bounds(0, 0, 1, 1);
+}
+
+BedMesh::~BedMesh()
+{
+    release();
+}
+
+void BedMesh::release()
+{
+    // free in the reverse order they were allocated so the pool joins them back up with the free space after them
+    if(coeff != nullptr) pool.dealloc(coeff);
+    if(heights != nullptr) pool.dealloc(heights);
+    heights= nullptr;
+    coeff= nullptr;
+    nx= ny= 0;
+}
+
+bool BedMesh::allocate(uint16_t nx, uint16_t ny, bool bicubic)
+{
+    release();
+    if(nx < 2 || ny < 2) return false;
+
+    heights= (int16_t *)pool.alloc(nx * ny * sizeof(int16_t));
+    coeff= (int16_t *)pool.alloc((nx - 1) * (ny - 1) * (bicubic ? 16 : 4) * sizeof(int16_t));
+    if(heights == nullptr || coeff == nullptr) {
+        release();
+        return false;
+    }
+
+    this->nx= nx;
+    this->ny= ny;
+    this->bicubic= bicubic;
+    height_scale= coeff_scale= 0.001F;
+    set_bounds(x0, y0, x1, y1);
+    return true;
+}
+
+// the same as allocate() but the new grid is allocated alongside the old one, which is only released once the new one
+// is known to fit, so a failure leaves the old grid as it was
+bool BedMesh::reallocate(uint16_t nx, uint16_t ny, bool bicubic)
+{
+    if(nx < 2 || ny < 2) return false;
+
+    int16_t *new_heights= (int16_t *)pool.alloc(nx * ny * sizeof(int16_t));
+    int16_t *new_coeff= (new_heights == nullptr) ? nullptr : (int16_t *)pool.alloc((nx - 1) * (ny - 1) * (bicubic ? 16 : 4) * sizeof(int16_t));
+    if(new_coeff == nullptr) {
+        if(new_heights != nullptr) pool.dealloc(new_heights);
+        return false;
+    }
+
+    release();
+    heights= new_heights;
+    coeff= new_coeff;
+    this->nx= nx;
+    this->ny= ny;
+    this->bicubic= bicubic;
+    height_scale= coeff_scale= 0.001F;
+    set_bounds(x0, y0, x1, y1);
+    return true;
+}
+
+void BedMesh::set_bounds(float x0, float y0, float x1, float y1)
+{
+    this->x0= x0;
+    this->y0= y0;
+    this->x1= x1;
+    this->y1= y1;
+    // the spacing is worked out again when a grid is allocated
+    dx= (nx > 1) ? (x1 - x0) / (nx - 1) : x1 - x0;
+    dy= (ny > 1) ? (y1 - y0) / (ny - 1) : y1 - y0;
+    inv_dx= 1.0F / dx;
+    inv_dy= 1.0F / dy;
+}
+
+uint32_t BedMesh::memory_needed(uint16_t nx, uint16_t ny, bool bicubic)
+{
+    return (nx * ny + (nx - 1) * (ny - 1) * (bicubic ? 16 : 4)) * sizeof(int16_t);
+}
+
+void BedMesh::set(int x, int y, float z)
+{
+    if(isnan(z)) {
+        heights[x + nx * y]= unset;
+        return;
+    }
+
+    // heights start off in micrometres, the scale doubles until they fit which loses a little of the ones already set
+    float q= roundf(z / height_scale);
+    while(fabsf(q) > INT16_MAX) {
+        halve_heights();
+        q= roundf(z / height_scale);
+    }
+    heights[x + nx * y]= q;
+}
+
+void BedMesh::halve_heights()
+{
+    height_scale *= 2;
+    for (int i = 0; i < nx * ny; ++i) {
+        if(heights[i] != unset) heights[i]= (heights[i] < 0) ? -((1 - heights[i]) / 2) : (heights[i] + 1) / 2;
+    }
+}
+
+void BedMesh::fill(float z)
+{
+    for (int y = 0; y < ny; ++y) {
+        for (int x = 0; x < nx; ++x) set(x, y, z);
+    }
+}
+
+void BedMesh::add(float z)
+{
+    for (int y = 0; y < ny; ++y) {
+        for (int x = 0; x < nx; ++x) set(x, y, get(x, y) + z);
+    }
+}
+
+// height at x,y allowing one point beyond each edge, continued linearly from the edge
+float BedMesh::extended(int x, int y) const
+{
+    if(x < 0) return 2 * extended(0, y) - extended(1, y);
+    if(x >= nx) return 2 * extended(nx - 1, y) - extended(nx - 2, y);
+    if(y < 0) return 2 * get(x, 0) - get(x, 1);
+    if(y >= ny) return 2 * get(x, ny - 1) - get(x, ny - 2);
+    return get(x, y);
+}
+
+// C = M * P * Mt / 4 where P is the 4x4 neighbourhood of the cell
+void BedMesh::build_bicubic(int cx, int cy, float *c) const
+{
+    float p[4][4], t[4][4];
+    for (int a = 0; a < 4; ++a) {
+        for (int b = 0; b < 4; ++b) {
+            p[a][b]= extended(cx - 1 + a, cy - 1 + b);
+        }
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        for (int b = 0; b < 4; ++b) {
+            float s= 0;
+            for (int a = 0; a < 4; ++a) s += catmull_rom[i][a] * p[a][b];
+            t[i][b]= s;
+        }
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            float s= 0;
+            for (int b = 0; b < 4; ++b) s += t[i][b] * catmull_rom[j][b];
+            c[j * 4 + i]= s * 0.25F;
+        }
+    }
+}
+
+void BedMesh::build()
+{
+    int ncells= (nx - 1) * (ny - 1);
+    float c[16];
+
+    if(!bicubic) {
+        // the bilinear coefficients are sums and differences of the stored heights so are exact,
+        // unless a very uneven bed takes them out of range and they have to be scaled down
+        int32_t biggest= 0;
+        for (int pass = 0; pass < 2; ++pass) {
+            int shift= 0;
+            while((biggest >> shift) > INT16_MAX) shift++;
+            coeff_scale= height_scale * (1 << shift);
+
+            int16_t *cc= coeff;
+            for (int cy = 0; cy < ny - 1; ++cy) {
+                for (int cx = 0; cx < nx - 1; ++cx) {
+                    int32_t z00= heights[cx + nx * cy], z10= heights[cx + 1 + nx * cy];
+                    int32_t z01= heights[cx + nx * (cy + 1)], z11= heights[cx + 1 + nx * (cy + 1)];
+                    int32_t ci[4]= {z00, z10 - z00, z01 - z00, z11 - z10 - z01 + z00};
+                    for (int i = 0; i < 4; ++i) {
+                        if(abs(ci[i]) > biggest) biggest= abs(ci[i]);
+                        cc[i]= (shift == 0) ? ci[i] : lroundf(ci[i] / (float)(1 << shift));
+                    }
+                    cc += 4;
+                }
+            }
+            if(biggest <= INT16_MAX) break; // the first pass fitted
+        }
+        return;
+    }
+
+    // the bicubic coefficients get scaled to make the most of 16 bits, the first pass finds the biggest
+    float biggest= 0;
+    for (int cell = 0; cell < ncells; ++cell) {
+        build_bicubic(cell % (nx - 1), cell / (nx - 1), c);
+        for (int i = 0; i < 16; ++i) {
+            if(fabsf(c[i]) > biggest) biggest= fabsf(c[i]);
+        }
+    }
+    coeff_scale= (biggest > 0) ? biggest / INT16_MAX : height_scale;
+
+    float inv_scale= 1.0F / coeff_scale;
+    int16_t *cc= coeff;
+    for (int cell = 0; cell < ncells; ++cell) {
+        build_bicubic(cell % (nx - 1), cell / (nx - 1), c);
+        for (int i = 0; i < 16; ++i) cc[i]= lroundf(c[i] * inv_scale);
+        cc += 16;
+    }
+}
+
+float BedMesh::interpolate(float x, float y) const
+{
+    float gx= (x - x0) * inv_dx;
+    float gy= (y - y0) * inv_dy;
+    int cx= floorf(gx);
+    int cy= floorf(gy);
+    if(cx < 0) cx= 0;
+    else if(cx > nx - 2) cx= nx - 2;
+    if(cy < 0) cy= 0;
+    else if(cy > ny - 2) cy= ny - 2;
+
+    float u= gx - cx;
+    float v= gy - cy;
+    // a cubic runs away quickly outside its cell so bicubic always holds the edge value
+    if(!extrapolate || bicubic) {
+        if(u < 0) u= 0;
+        else if(u > 1) u= 1;
+        if(v < 0) v= 0;
+        else if(v > 1) v= 1;
+    }
+
+    int cell= cx + (nx - 1) * cy;
+    if(bicubic) {
+        const int16_t *c= &coeff[cell * 16];
+        float r0= ((c[3] * u + c[2]) * u + c[1]) * u + c[0];
+        float r1= ((c[7] * u + c[6]) * u + c[5]) * u + c[4];
+        float r2= ((c[11] * u + c[10]) * u + c[9]) * u + c[8];
+        float r3= ((c[15] * u + c[14]) * u + c[13]) * u + c[12];
+        return (((r3 * v + r2) * v + r1) * v + r0) * coeff_scale;
+    }
+
+    const int16_t *c= &coeff[cell * 4];
+    return (c[0] + c[1] * u + (c[2] + c[3] * u) * v) * coeff_scale;
+}
+
+// how far the surface bows away from the chord between fractions t0 and t1 along the line a + d*t, sampled along it
+float BedMesh::chord_error(const float a[], const float d[], float t0, float t1) const
+{
+    float z0= interpolate(a[0] + d[0] * t0, a[1] + d[1] * t0);
+    float z1= interpolate(a[0] + d[0] * t1, a[1] + d[1] * t1);
+    float err= 0;
+    for (int i = 1; i < 8; ++i) {
+        float s= i * 0.125F;
+        float ts= t0 + (t1 - t0) * s;
+        float e= fabsf(interpolate(a[0] + d[0] * ts, a[1] + d[1] * ts) - (z0 + (z1 - z0) * s));
+        if(e > err) err= e;
+    }
+    return err;
+}
+
+float BedMesh::next_split(const float a[], const float b[], float t, float max_error) const
+{
+    float d[2]= {b[0] - a[0], b[1] - a[1]};
+    float end= next_grid_line(a[0], d[0], t, x0, dx, inv_dx, nx);
+    float ey= next_grid_line(a[1], d[1], t, y0, dy, inv_dy, ny);
+    if(ey < end) end= ey;
+
+    // within a cell the surface along the line is a low order polynomial, the error goes down roughly with the square
+    // of the number of pieces it is cut into, but not exactly for bicubic so check and add pieces until it is good
+    float err= chord_error(a, d, t, end);
+    if(err > max_error) {
+        float n= ceilf(sqrtf(err / max_error));
+        for (int tries = 0; tries < 4 && chord_error(a, d, t, t + (end - t) / n) > max_error; ++tries) n += 1;
+        end= t + (end - t) / n;
+    }
+    return end;
+}
+
+uint32_t BedMesh::image_size() const
+{
+    uint32_t size= sizeof(mesh_file_header) + nx * ny * sizeof(int16_t);
+    return (size + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1);
+}
+
+void BedMesh::write_image(uint8_t *buf, float z_offset) const
+{
+    mesh_file_header h;
+    h.magic= MESH_FILE_MAGIC;
+    h.version= MESH_FILE_VERSION;
+    h.header_size= sizeof(h);
+    h.nx= nx;
+    h.ny= ny;
+    h.x0= x0;
+    h.y0= y0;
+    h.x1= x1;
+    h.y1= y1;
+    h.height_scale= height_scale;
+    h.z_offset= z_offset;
+    h.payload_size= nx * ny * sizeof(int16_t);
+    h.crc= 0;
+
+    memset(buf, 0, image_size());
+    memcpy(buf, &h, sizeof(h));
+    memcpy(buf + sizeof(h), heights, h.payload_size);
+    h.crc= crc32(0, buf, sizeof(h) + h.payload_size);
+    memcpy(buf + offsetof(mesh_file_header, crc), &h.crc, sizeof(h.crc));
+}
+
+const char *BedMesh::read_image(const uint8_t *buf, uint32_t size, float &z_offset)
+{
+    mesh_file_header h;
+    if(size < sizeof(h)) return "file too short";
+    memcpy(&h, buf, sizeof(h));
+    if(h.magic != MESH_FILE_MAGIC) return "not a mesh file";
+    if(h.version != MESH_FILE_VERSION || h.header_size != sizeof(h)) return "unsupported mesh file version";
+    if(h.nx < 2 || h.ny < 2 || h.payload_size != h.nx * h.ny * sizeof(int16_t)) return "bad grid size";
+    if(size < sizeof(h) + h.payload_size) return "file too short";
+
+    // the header went into the CRC with the CRC zeroed, and it chains on through the heights
+    uint32_t crc= h.crc;
+    h.crc= 0;
+    if(crc32(crc32(0, (const uint8_t *)&h, sizeof(h)), buf + sizeof(h), h.payload_size) != crc) return "bad CRC";
+
+    if(h.nx != nx || h.ny != ny) {
+        if(!reallocate(h.nx, h.ny, bicubic)) return "not enough memory for the grid";
+    }
+    height_scale= h.height_scale;
+    memcpy(heights, buf + sizeof(h), h.payload_size);
+    set_bounds(h.x0, h.y0, h.x1, h.y1);
+    z_offset= h.z_offset;
+    return nullptr;
+}
+
+bool BedMesh::is_mesh_file(const char *filename)
+{
+    FILE *fp= fopen(filename, "r");
+    if(fp == NULL) return false;
+    uint32_t magic= 0;
+    bool ok= fread(&magic, sizeof(magic), 1, fp) == 1 && magic == MESH_FILE_MAGIC;
+    fclose(fp);
+    return ok;
+}
+
+// the image is written and read with a single call so the file system can move whole sectors straight to and from the card
+const char *BedMesh::save(const char *filename, float z_offset) const
+{
+    uint32_t size= image_size();
+    uint8_t *buf= new uint8_t[size];
+    write_image(buf, z_offset);
+
+    const char *error= nullptr;
+    FILE *fp= fopen(filename, "w");
+    if(fp == NULL) {
+        error= "failed to open file";
+    } else {
+        if(fwrite(buf, size, 1, fp) != 1) error= "failed to write file";
+        fclose(fp);
+    }
+
+    delete [] buf;
+    return error;
+}
+
+const char *BedMesh::load(const char *filename, float &z_offset)
+{
+    FILE *fp= fopen(filename, "r");
+    if(fp == NULL) return "failed to open file";
+
+    fseek(fp, 0, SEEK_END);
+    long size= ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if(size < (long)sizeof(mesh_file_header) || size > 65536) {
+        fclose(fp);
+        return "bad file size";
+    }
+
+    uint8_t *buf= new uint8_t[size];
+    const char *error= nullptr;
+    if(fread(buf, size, 1, fp) != 1) error= "failed to read file";
+    fclose(fp);
+
+    if(error == nullptr) error= read_image(buf, size, z_offset);
+    delete [] buf;
+    return error;
+}
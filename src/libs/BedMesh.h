@@ -0,0 +1,87 @@
+#ifndef _BEDMESH_H
+#define _BEDMESH_H
+
+#include <stdint.h>
+#include <math.h>
+
+class MemoryPool;
+
+// A height map of nx by ny points spaced evenly over a rectangle of the bed.
+// Once the heights are filled in build() works out the polynomial for each cell, bilinear or
+// Catmull-Rom bicubic, so a lookup is just finding the cell and a few multiply-adds.
+// Heights and coefficients are kept as int16 multiples of a per grid scale, a micrometre unless the bed
+// needs more range, which is half the memory of floats so twice the points fit in the same space
+class BedMesh
+{
+public:
+    BedMesh(MemoryPool &pool);
+    ~BedMesh();
+
+    // (re)allocate the heights and coefficients for a grid of nx by ny points, heights are left undefined
+    bool allocate(uint16_t nx, uint16_t ny, bool bicubic);
+    void release();
+    // the grid points run from x0,y0 to x1,y1
+    void set_bounds(float x0, float y0, float x1, float y1);
+    // extrapolate linearly from the edge cells for points outside the bounds, otherwise the edge value is held
+    void set_extrapolate(bool flg) { extrapolate= flg; }
+
+    bool is_allocated() const { return heights != nullptr; }
+    uint16_t get_nx() const { return nx; }
+    uint16_t get_ny() const { return ny; }
+    float get_x(int x) const { return x0 + x * dx; }
+    float get_y(int y) const { return y0 + y * dy; }
+
+    // NAN marks a point that has not been probed
+    float get(int x, int y) const { int16_t h= heights[x + nx * y]; return h == unset ? NAN : h * height_scale; }
+    void set(int x, int y, float z);
+    void fill(float z);
+    void add(float z);
+
+    // precompute the cell polynomials, must be called after the heights change and before interpolate()
+    void build();
+    float interpolate(float x, float y) const;
+    // where the next segment of the XY line a to b that starts at fraction t along it should end. Segments end where
+    // the line crosses a grid line, as the surface has a kink there, and are split evenly within a cell so the chord
+    // stays within max_error of the surface
+    float next_split(const float a[], const float b[], float t, float max_error) const;
+
+    // the size of one step of the stored heights and of the interpolated surface, in mm
+    float get_height_resolution() const { return height_scale; }
+    float get_resolution() const { return coeff_scale; }
+    static uint32_t memory_needed(uint16_t nx, uint16_t ny, bool bicubic);
+
+    // The grid is saved as one binary image: a versioned header with the size, bounds and scale, the heights and a CRC32,
+    // padded out to whole sectors so it goes to and from the SD card in one go. z_offset is kept with it for the strategy
+    uint32_t image_size() const;
+    void write_image(uint8_t *buf, float z_offset) const;
+    // returns nullptr if the image was good and has been loaded, reallocating to its size, otherwise what was wrong with it
+    const char *read_image(const uint8_t *buf, uint32_t size, float &z_offset);
+
+    static bool is_mesh_file(const char *filename);
+    const char *save(const char *filename, float z_offset= 0) const;
+    const char *load(const char *filename, float &z_offset);
+
+private:
+    bool reallocate(uint16_t nx, uint16_t ny, bool bicubic);
+    float extended(int x, int y) const;
+    float chord_error(const float a[], const float d[], float t0, float t1) const;
+    void build_bicubic(int cx, int cy, float *c) const;
+    void halve_heights();
+
+    static const int16_t unset= INT16_MIN;
+
+    MemoryPool &pool;
+    int16_t *heights;   // multiples of height_scale
+    int16_t *coeff;     // 4 (bilinear) or 16 (bicubic) per cell, lowest power of u first then v, multiples of coeff_scale
+    float height_scale, coeff_scale;
+    float x0, y0, x1, y1;
+    float dx, dy;
+    float inv_dx, inv_dy;
+    uint16_t nx, ny;
+    struct {
+        bool bicubic:1;
+        bool extrapolate:1;
+    };
+};
+
+#endif /* _BEDMESH_H */
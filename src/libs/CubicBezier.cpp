@@ -0,0 +1,63 @@
+#include "CubicBezier.h"
+
+#include <fastmath.h>
+
+// A parabola (quadratic bezier s, c, e) written as a cubic. It is tangent to both lines at its ends,
+// and passes c at a distance of |s-c| * sin(turn/2) / 2 at its midpoint
+CubicBezier CubicBezier::corner_blend(const Vector3 &s, const Vector3 &c, const Vector3 &e)
+{
+    return CubicBezier(s, s.add(c.sub(s).mul(2.0F / 3.0F)), e.add(c.sub(e).mul(2.0F / 3.0F)), e);
+}
+
+float CubicBezier::corner_blend_length(const Vector3 &u_in, const Vector3 &u_out, float max_deviation)
+{
+    // |u_out - u_in| is 2*sin(turn/2)
+    float sin_half_turn = u_out.sub(u_in).mag() / 2.0F;
+    if(sin_half_turn < 0.000001F) return INFINITY;
+    return 2.0F * max_deviation / sin_half_turn;
+}
+
+Vector3 CubicBezier::point(float t) const
+{
+    float mt = 1.0F - t;
+    return p[0].mul(mt * mt * mt).add(p[1].mul(3.0F * mt * mt * t)).add(p[2].mul(3.0F * mt * t * t)).add(p[3].mul(t * t * t));
+}
+
+void CubicBezier::derivatives(float t, Vector3 &d1, Vector3 &d2) const
+{
+    float mt = 1.0F - t;
+    Vector3 a = p[1].sub(p[0]), b = p[2].sub(p[1]), c = p[3].sub(p[2]);
+    d1 = a.mul(3.0F * mt * mt).add(b.mul(6.0F * mt * t)).add(c.mul(3.0F * t * t));
+    d2 = b.sub(a).mul(6.0F * mt).add(c.sub(b).mul(6.0F * t));
+}
+
+float CubicBezier::curvature(float t) const
+{
+    Vector3 d1, d2;
+    derivatives(t, d1, d2);
+    float speed = d1.mag();
+    if(speed < 0.000001F) return 0;
+    return d1.cross(d2).mag() / (speed * speed * speed);
+}
+
+float CubicBezier::next_t(float t, float max_error) const
+{
+    Vector3 d1, d2;
+    derivatives(t, d1, d2);
+    float speed = d1.mag();
+    if(speed < 0.000001F) return fminf(t + 0.01F, 1.0F); // a cusp or a control point on an end, creep past it
+
+    // a chord of length l on a circle of radius r is r-sqrt(r²-l²/4) from it, so l= sqrt(8re) near enough
+    float k = d1.cross(d2).mag() / (speed * speed * speed);
+    if(k < 0.000001F) k = 0.000001F;
+    float dt = sqrtf(8.0F * max_error / k) / speed;
+
+    // the curvature may tighten up within the step, so check the other end as well
+    if(t + dt < 1.0F) {
+        float ek = curvature(t + dt);
+        if(ek > k) dt *= sqrtf(k / ek);
+    }
+
+    if(dt < 0.001F) dt = 0.001F; // we don't want thousands of segments for a tiny kink
+    return (t + dt > 0.999F) ? 1.0F : t + dt;
+}
@@ -0,0 +1,28 @@
+#ifndef _CUBICBEZIER_H
+#define _CUBICBEZIER_H
+
+#include "Vector3.h"
+
+// A cubic bezier curve in 3D, used to flatten G5 splines and corner blends into line segments
+class CubicBezier
+{
+public:
+    CubicBezier(const Vector3 &p0, const Vector3 &p1, const Vector3 &p2, const Vector3 &p3) : p{p0, p1, p2, p3} {}
+
+    // a parabolic blend that leaves s heading towards corner c and arrives at e heading away from it
+    static CubicBezier corner_blend(const Vector3 &s, const Vector3 &c, const Vector3 &e);
+    // how far back from a corner between unit vectors u_in and u_out a corner_blend must start to pass max_deviation from it
+    static float corner_blend_length(const Vector3 &u_in, const Vector3 &u_out, float max_deviation);
+
+    Vector3 point(float t) const;
+    float curvature(float t) const;
+    // the next value of t along the curve such that the chord from t to it is no more than max_error from the curve
+    float next_t(float t, float max_error) const;
+
+private:
+    void derivatives(float t, Vector3 &d1, Vector3 &d2) const;
+
+    Vector3 p[4];
+};
+
+#endif /* _CUBICBEZIER_H */
@@ -1,6 +1,7 @@
 #include "HeapRing.h"
 
 #include <cstdlib>
+#include <atomic>
 
 #include "cmsis.h"
 
@@ -10,16 +11,15 @@
 
 template<class kind> HeapRing<kind>::HeapRing()
 {
-    head_i = tail_i = length = 0;
+    head_i = tail_i = length = mask = 0;
     ring = NULL;
 }
 
 template<class kind> HeapRing<kind>::HeapRing(unsigned int length)
 {
-    head_i = tail_i = 0;
-    ring = new kind[length];
-    // TODO: handle allocation failure
-    this->length = length;
+    head_i = tail_i = this->length = mask = 0;
+    ring = NULL;
+    resize(length);
 }
 
 /*
@@ -28,7 +28,7 @@ template<class kind> HeapRing<kind>::HeapRing(unsigned int length)
 
 template<class kind> HeapRing<kind>::~HeapRing()
 {
-    head_i = tail_i = length = 0;
+    head_i = tail_i = length = mask = 0;
     if (ring)
         delete [] ring;
     ring = NULL;
@@ -38,26 +38,18 @@ template<class kind> HeapRing<kind>::~HeapRing()
  * index accessors (protected)
  */
 
-template<class kind> unsigned int HeapRing<kind>::next(unsigned int item)
+template<class kind> unsigned int HeapRing<kind>::load_head()
 {
-    if (length == 0)
-        return 0;
-
-    if (++item >= length)
-        return 0;
-
-    return item;
+    unsigned int h = head_i;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return h;
 }
 
-template<class kind> unsigned int HeapRing<kind>::prev(unsigned int item)
+template<class kind> unsigned int HeapRing<kind>::load_tail()
 {
-    if (length == 0)
-        return 0;
-
-    if (item == 0)
-        return (length - 1);
-    else
-        return (item - 1);
+    unsigned int t = tail_i;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return t;
 }
 
 /*
@@ -79,17 +71,24 @@ template<class kind> kind& HeapRing<kind>::item(unsigned int i)
     return ring[i];
 }
 
-template<class kind> void HeapRing<kind>::push_front(kind& item)
+template<class kind> bool HeapRing<kind>::push(const kind& item)
 {
+    if (is_full())
+        return false;
+
     ring[head_i] = item;
-    head_i = next(head_i);
+    produce_head();
+    return true;
 }
 
-template<class kind> kind& HeapRing<kind>::pop_back()
+template<class kind> bool HeapRing<kind>::pop(kind& item)
 {
-    kind& r = ring[tail_i];
-    tail_i = next(tail_i);
-    return r;
+    if (is_empty())
+        return false;
+
+    item = ring[tail_i];
+    consume_tail();
+    return true;
 }
 
 /*
@@ -114,13 +113,18 @@ template<class kind> kind* HeapRing<kind>::item_ref(unsigned int i)
 template<class kind> void HeapRing<kind>::produce_head()
 {
     while (is_full());
+    // the item is written before the index that hands it over
+    std::atomic_thread_fence(std::memory_order_release);
     head_i = next(head_i);
 }
 
 template<class kind> void HeapRing<kind>::consume_tail()
 {
-    if (!is_empty())
+    if (!is_empty()) {
+        // the item is finished with before the index that hands it back
+        std::atomic_thread_fence(std::memory_order_release);
         tail_i = next(tail_i);
+    }
 }
 
 /*
@@ -129,20 +133,17 @@ template<class kind> void HeapRing<kind>::consume_tail()
 
 template<class kind> bool HeapRing<kind>::is_full()
 {
-    __disable_irq();
-    bool r = (next(head_i) == tail_i);
-    __enable_irq();
-
-    return r;
+    return next(head_i) == load_tail();
 }
 
 template<class kind> bool HeapRing<kind>::is_empty()
 {
-    __disable_irq();
-    bool r = (head_i == tail_i);
-    __enable_irq();
+    return load_head() == load_tail();
+}
 
-    return r;
+template<class kind> unsigned int HeapRing<kind>::size()
+{
+    return (load_head() - load_tail()) & mask;
 }
 
 /*
@@ -159,7 +160,7 @@ template<class kind> bool HeapRing<kind>::resize(unsigned int length)
 
             if (is_empty()) // check again in case something was pushed
             {
-                head_i = tail_i = this->length = 0;
+                head_i = tail_i = this->length = mask = 0;
 
                 __enable_irq();
 
@@ -175,8 +176,12 @@ template<class kind> bool HeapRing<kind>::resize(unsigned int length)
             return false;
         }
 
+        unsigned int n = 2;
+        while (n * 2 <= length)
+            n <<= 1;
+
         // Note: we don't use realloc so we can fall back to the existing ring if allocation fails
-        kind* newring = new kind[length];
+        kind* newring = new kind[n];
 
         if (newring != NULL)
         {
@@ -187,7 +192,8 @@ template<class kind> bool HeapRing<kind>::resize(unsigned int length)
             if (is_empty()) // check again in case something was pushed while malloc did its thing
             {
                 ring = newring;
-                this->length = length;
+                this->length = n;
+                mask = n - 1;
                 head_i = tail_i = 0;
 
                 __enable_irq();
@@ -215,10 +221,11 @@ template<class kind> bool HeapRing<kind>::provide(kind* buffer, unsigned int len
     {
         kind* oldring = ring;
 
-        if ((buffer != NULL) && (length > 0))
+        if ((buffer != NULL) && (length > 0) && ((length & (length - 1)) == 0))
         {
             ring = buffer;
             this->length = length;
+            mask = length - 1;
             head_i = tail_i = 0;
 
             __enable_irq();
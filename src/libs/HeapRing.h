@@ -1,6 +1,11 @@
 #ifndef _HEAPRING_H
 #define _HEAPRING_H
 
+// A ring of items on the heap shared by one producer, which fills head and produces it, and one consumer, which
+// consumes tail, each of which may be an interrupt. Neither side disables interrupts, each only writes its own index and
+// publishes it after a barrier so the other side sees the item before the index that covers it. The length is always a
+// power of two so indexes wrap with a mask, one item is kept free to tell full from empty.
+// resize() and provide() are the exception, they must not race with the consumer and briefly disable interrupts
 template<class kind> class HeapRing {
 
     // smoothie-specific friend classes
@@ -20,8 +25,11 @@ public:
     kind& head();
     kind& tail();
 
-    void push_front(kind&) __attribute__ ((warning("Not thread-safe if pop_back() is used in ISR context!"))); // instead, prepare(head_ref()); produce_head();
-    kind& pop_back(void) __attribute__ ((warning("Not thread-safe if head_ref() is used to prepare new items, or push_front() is used in ISR context!"))); // instead, consume(tail_ref()); consume_tail();
+    /*
+     * copy accessors, return false if full or empty
+     */
+    bool push(const kind&); // producer only
+    bool pop(kind&);        // consumer only
 
     /*
      * pointer accessors
@@ -37,10 +45,17 @@ public:
      */
     bool is_empty(void);
     bool is_full(void);
+    unsigned int size(void);     // items queued, as seen by either side
+    unsigned int capacity(void) { return length ? length - 1 : 0; }
+
+    // the i'th item from tail, consumer only and i < size()
+    kind& peek(unsigned int i) { return ring[(tail_i + i) & mask]; }
 
     /*
      * resize
      *
+     * the length is rounded down to a power of two, so it never uses more memory than asked for, and is at least 2
+     *
      * returns true on success, or false if queue is not empty or not enough memory available
      */
     bool resize(unsigned int);
@@ -48,7 +63,7 @@ public:
     /*
      * provide
      * kind*      - new buffer pointer
-     * int length - number of items in buffer (NOT size in bytes!)
+     * int length - number of items in buffer (NOT size in bytes!), a power of two
      *
      * cause HeapRing to use a specific memory location instead of allocating its own
      *
@@ -64,13 +79,18 @@ protected:
     kind& item(unsigned int);
     kind* item_ref(unsigned int);
 
-    unsigned int next(unsigned int);
-    unsigned int prev(unsigned int);
+    unsigned int next(unsigned int i) { return (i + 1) & mask; }
+    unsigned int prev(unsigned int i) { return (i - 1) & mask; }
+
+    // read the other side's index, anything it published before it is visible after
+    unsigned int load_head(void);
+    unsigned int load_tail(void);
 
     /*
      * buffer variables
      */
     unsigned int length;
+    unsigned int mask;
 
     volatile unsigned int head_i;
     volatile unsigned int tail_i;
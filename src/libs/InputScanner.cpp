@@ -0,0 +1,77 @@
+#include "InputScanner.h"
+
+#include "Kernel.h"
+#include "SlowTicker.h"
+#include "Pin.h"
+
+#include <string.h>
+
+InputScanner::InputScanner()
+{
+    memset(mask, 0, sizeof mask);
+    memset(invert, 0, sizeof invert);
+    memset(state, 0, sizeof state);
+    memset(cnt0, 0, sizeof cnt0);
+    memset(cnt1, 0, sizeof cnt1);
+    started= false;
+}
+
+int InputScanner::attach(Pin &pin, handler_t fn)
+{
+    if(!pin.connected()) return -1;
+
+    // the vector and masks can't change under the ticker
+    __disable_irq();
+    int id= attach(pin.port_number, pin.pin, pin.is_inverting(), pin.get(), fn);
+    __enable_irq();
+
+    if(!started) {
+        started= true;
+        THEKERNEL->slow_ticker->attach(frequency, this, &InputScanner::tick);
+    }
+    return id;
+}
+
+int InputScanner::attach(uint8_t port, uint8_t bit, bool inverting, bool initial, handler_t fn)
+{
+    uint32_t m= 1 << bit;
+    mask[port] |= m;
+    if(inverting) invert[port] |= m;
+    else invert[port] &= ~m;
+    if(initial) state[port] |= m;
+    else state[port] &= ~m;
+    inputs.push_back({fn, m, port});
+    return inputs.size() - 1;
+}
+
+void InputScanner::scan(const uint32_t sample[ports])
+{
+    for (int p = 0; p < ports; ++p) {
+        if(mask[p] == 0) continue;
+
+        // a bit of delta is set for each input that reads differently from its debounced state, and counts up while it
+        // does, any sample that agrees resets its count. When the count wraps round to zero the state flips
+        uint32_t delta= ((sample[p] ^ invert[p]) ^ state[p]) & mask[p];
+        cnt1[p]= (cnt1[p] ^ cnt0[p]) & delta;
+        cnt0[p]= ~cnt0[p] & delta;
+        uint32_t changed= delta & ~(cnt0[p] | cnt1[p]);
+        if(changed == 0) continue;
+
+        state[p] ^= changed;
+        for(auto &i : inputs) {
+            if(i.port == p && (i.mask & changed) && i.fn) i.fn((state[p] & i.mask) != 0);
+        }
+    }
+}
+
+uint32_t InputScanner::tick(uint32_t dummy)
+{
+    static LPC_GPIO_TypeDef *const gpios[ports]= {LPC_GPIO0, LPC_GPIO1, LPC_GPIO2, LPC_GPIO3, LPC_GPIO4};
+
+    uint32_t sample[ports];
+    for (int p = 0; p < ports; ++p) {
+        sample[p]= mask[p] ? gpios[p]->FIOPIN : 0;
+    }
+    scan(sample);
+    return 0;
+}
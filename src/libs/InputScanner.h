@@ -0,0 +1,51 @@
+#ifndef _INPUTSCANNER_H
+#define _INPUTSCANNER_H
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+class Pin;
+
+// Scans all the digital inputs from one slow ticker hook. Each tick reads every GPIO port that has an input on it once,
+// debounces all the bits of a port together with vertical counters, and calls the handlers of the inputs whose
+// debounced state changed. That replaces a hook per input each reading its own pin
+class InputScanner
+{
+public:
+    typedef std::function<void(bool)> handler_t;
+    static const int ports= 5;
+    static const uint32_t frequency= 1000;
+
+    InputScanner();
+
+    // scan pin, calling fn from the ticker interrupt with the debounced state each time it changes, which starts as the
+    // pin is now. Returns an id for get()
+    int attach(Pin &pin, handler_t fn= nullptr);
+    // as above without reading the pin or starting the ticker
+    int attach(uint8_t port, uint8_t bit, bool inverting, bool initial, handler_t fn);
+
+    // the debounced state of an input
+    bool get(int id) const { return (state[inputs[id].port] & inputs[id].mask) != 0; }
+
+    // debounce one sample of each port, an input changes state after reading the other way on 4 samples in a row
+    void scan(const uint32_t sample[ports]);
+    uint32_t tick(uint32_t dummy);
+
+private:
+    struct input_t {
+        handler_t fn;
+        uint32_t mask;
+        uint8_t port;
+    };
+    std::vector<input_t> inputs;
+
+    uint32_t mask[ports];    // bits that are inputs
+    uint32_t invert[ports];  // bits of inverted inputs
+    uint32_t state[ports];   // debounced state of each input, true if active
+    uint32_t cnt0[ports];    // low and high bits of a 2 bit counter per input, of samples in a row differing from state
+    uint32_t cnt1[ports];
+    bool started;
+};
+
+#endif /* _INPUTSCANNER_H */
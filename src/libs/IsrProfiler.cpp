@@ -0,0 +1,15 @@
+#include "IsrProfiler.h"
+
+#ifdef ISR_PROFILE
+IsrProfiler IsrProfiler::instance;
+#endif
+
+void IsrProfiler::start()
+{
+    volatile uint32_t *const demcr= (volatile uint32_t *)0xE000EDFC;
+    volatile uint32_t *const dwt_ctrl= (volatile uint32_t *)0xE0001000;
+
+    *demcr |= (1UL << 24);      // TRCENA, power the DWT
+    *(volatile uint32_t *)0xE0001004= 0; // DWT_CYCCNT
+    *dwt_ctrl |= 1;             // CYCCNTENA
+}
@@ -0,0 +1,111 @@
+#ifndef _ISRPROFILER_H
+#define _ISRPROFILER_H
+
+#include <stdint.h>
+
+// Times the interrupts that have to keep up with motion, to see how close they are to overrunning. Built with
+// ISR_PROFILE each ISR_PROFILE_SCOPE reads the DWT cycle counter on entry and exit and records the difference in a
+// fixed table, with the count, min, max, total for the mean and a histogram with a bucket per power of two of cycles.
+// A time includes any higher priority interrupt that pre-empted the one being timed.
+// Without ISR_PROFILE the scopes compile to nothing and there is no table
+class IsrProfiler
+{
+public:
+    enum ISR_ID {
+        STEP_TICKER,  // TIMER0
+        PENDSV,       // end of block
+        ACCELERATION, // RIT
+        SLOW_TICKER,  // TIMER2
+        NUM_ISRS
+    };
+
+    // bucket b holds times of 2^(b-1) to 2^b - 1 cycles, the last one everything longer
+    static const int buckets= 20;
+
+    struct stats_t {
+        uint32_t count;
+        uint32_t min;
+        uint32_t max;
+        uint64_t total;
+        uint32_t histogram[buckets];
+        volatile bool reset; // cleared by the next record, so the interrupt is the only thing that writes the stats
+    };
+
+    IsrProfiler()
+    {
+        for (int i = 0; i < NUM_ISRS; ++i) clear(stats[i]);
+    }
+
+    // called from the interrupt being timed
+    void record(int isr, uint32_t cycles)
+    {
+        stats_t &s= stats[isr];
+        if(s.reset) clear(s);
+        s.count++;
+        s.total += cycles;
+        if(cycles < s.min) s.min= cycles;
+        if(cycles > s.max) s.max= cycles;
+        s.histogram[bucket(cycles)]++;
+    }
+
+    // start all of them again from their next record
+    void reset()
+    {
+        for (int i = 0; i < NUM_ISRS; ++i) stats[i].reset= true;
+    }
+
+    // stats of one, which were reset if get(isr).reset or get(isr).count is 0
+    const stats_t &get(int isr) const { return stats[isr]; }
+
+    static int bucket(uint32_t cycles)
+    {
+        int b= cycles == 0 ? 0 : 32 - __builtin_clz(cycles);
+        return b < buckets ? b : buckets - 1;
+    }
+
+    static const char *name(int isr)
+    {
+        static const char *const names[NUM_ISRS]= {"step", "pendsv", "accel", "slowtick"};
+        return names[isr];
+    }
+
+    // turn on the DWT cycle counter, which the kernel's event times also use
+    static void start();
+    static inline uint32_t cycles() { return *(volatile uint32_t *)0xE0001004; } // DWT_CYCCNT
+
+#ifdef ISR_PROFILE
+    static IsrProfiler instance;
+
+    class Scope
+    {
+    public:
+        Scope(int isr) : isr(isr), begin(cycles()) {}
+        ~Scope() { instance.record(isr, cycles() - begin); }
+
+    private:
+        int isr;
+        uint32_t begin;
+    };
+#endif
+
+private:
+    static void clear(stats_t &s)
+    {
+        s.count= 0;
+        s.min= UINT32_MAX;
+        s.max= 0;
+        s.total= 0;
+        for (int i = 0; i < buckets; ++i) s.histogram[i]= 0;
+        s.reset= false;
+    }
+
+    stats_t stats[NUM_ISRS];
+};
+
+#ifdef ISR_PROFILE
+#define ISR_PROFILE_SCOPE(isr) IsrProfiler::Scope isr_profile_scope(isr)
+#else
+#define ISR_PROFILE_SCOPE(isr)
+#endif
+
+#endif /* _ISRPROFILER_H */
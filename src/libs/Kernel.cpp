@@ -11,6 +11,8 @@
 #include "libs/nuts_bolts.h"
 #include "libs/SlowTicker.h"
 #include "libs/Adc.h"
+#include "libs/InputScanner.h"
+#include "libs/IsrProfiler.h"
 #include "libs/StreamOutputPool.h"
 #include <mri.h>
 #include "checksumm.h"
@@ -32,6 +34,8 @@
 
 #include "platform_memory.h"
 
+#include "mbed.h" // for us_ticker_read()
+
 #include <malloc.h>
 #include <array>
 #include <string>
@@ -52,9 +56,15 @@ Kernel* Kernel::instance;
 Kernel::Kernel(){
     halted= false;
     feed_hold= false;
+    jog_cancel= false;
 
     instance= this; // setup the Singleton instance of the kernel
 
+#ifdef EVENT_PROFILE
+    IsrProfiler::start();
+    reset_event_times();
+#endif
+
     // serial first at fixed baud rate (DEFAULT_SERIAL_BAUD_RATE) so config can report errors to serial
 	// Set to UART0, this will be changed to use the same UART as MRI if it's enabled
     this->serial = new SerialConsole(USBTX, USBRX, DEFAULT_SERIAL_BAUD_RATE);
@@ -107,6 +117,7 @@ Kernel::Kernel(){
 
     // HAL stuff
     add_module( this->slow_ticker = new SlowTicker());
+    this->input_scanner = new InputScanner();
 
     this->step_ticker = new StepTicker();
     this->adc = new(AHB0) Adc();
@@ -174,6 +185,9 @@ std::string Kernel::get_query_string()
         str.append("Home,");
     }else if(feed_hold) {
         str.append("Hold,");
+    }else if(robot->is_jogging()) {
+        running= true;
+        str.append("Jog,");
     }else if(this->conveyor->is_queue_empty()) {
         str.append("Idle,");
     }else{
@@ -230,6 +244,9 @@ void Kernel::add_module(Module* module){
 // Adds a hook for a given module and event
 void Kernel::register_for_event(_EVENT_ENUM id_event, Module *mod){
     this->hooks[id_event].push_back(mod);
+#ifdef EVENT_PROFILE
+    this->event_times[id_event].push_back({0, 0, 0});
+#endif
 }
 
 // Call a specific event with an argument
@@ -237,11 +254,41 @@ void Kernel::call_event(_EVENT_ENUM id_event, void * argument){
     if(id_event == ON_HALT) {
         this->halted= (argument == nullptr);
     }
+#ifdef EVENT_PROFILE
+    // time each handler, not counting the time in handlers of any events it calls itself, eg ON_IDLE while it waits
+    for (size_t i = 0; i < hooks[id_event].size(); ++i) {
+        uint32_t nested= event_nested_cycles;
+        event_nested_cycles= 0;
+        uint32_t begin= IsrProfiler::cycles();
+        (hooks[id_event][i]->*kernel_callback_functions[id_event])(argument);
+        uint32_t cycles= IsrProfiler::cycles() - begin;
+        uint32_t own= cycles - event_nested_cycles;
+        event_nested_cycles= nested + cycles;
+
+        if(i >= event_times[id_event].size()) break; // it unregistered itself
+        event_time_t &t= event_times[id_event][i];
+        t.total += own;
+        t.calls++;
+        if(own > t.max) t.max= own;
+    }
+#else
     for (auto m : hooks[id_event]) {
         (m->*kernel_callback_functions[id_event])(argument);
     }
+#endif
 }
 
+#ifdef EVENT_PROFILE
+void Kernel::reset_event_times()
+{
+    for (auto &e : event_times) {
+        for (auto &t : e) t= {0, 0, 0};
+    }
+    event_nested_cycles= 0;
+    event_times_start= us_ticker_read();
+}
+#endif
+
 // These are used by tests to test for various things. basically mocks
 bool Kernel::kernel_has_event(_EVENT_ENUM id_event, Module *mod)
 {
@@ -255,6 +302,9 @@ void Kernel::unregister_for_event(_EVENT_ENUM id_event, Module *mod)
 {
     for (auto i = hooks[id_event].begin(); i != hooks[id_event].end(); ++i) {
         if(*i == mod) {
+#ifdef EVENT_PROFILE
+            event_times[id_event].erase(event_times[id_event].begin() + (i - hooks[id_event].begin()));
+#endif
             hooks[id_event].erase(i);
             return;
         }
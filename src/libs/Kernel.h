@@ -28,6 +28,7 @@ class Stepper;
 class Planner;
 class StepTicker;
 class Adc;
+class InputScanner;
 class PublicData;
 class SimpleShell;
 class Configurator;
@@ -52,9 +53,24 @@ class Kernel {
 
         void set_feed_hold(bool f) { feed_hold= f; }
         bool get_feed_hold() const { return feed_hold; }
+        void set_jog_cancel(bool f) { jog_cancel= f; }
+        bool get_jog_cancel() const { return jog_cancel; }
 
         std::string get_query_string();
 
+#ifdef EVENT_PROFILE
+        // time spent in each module's handler of each event, for the top command
+        struct event_time_t {
+            uint64_t total; // cycles in the handler, less those in handlers of events it called in turn
+            uint32_t max;
+            uint32_t calls;
+        };
+        const std::vector<Module*>& get_hooks(_EVENT_ENUM id_event) const { return hooks[id_event]; }
+        const std::vector<event_time_t>& get_event_times(_EVENT_ENUM id_event) const { return event_times[id_event]; }
+        uint32_t get_event_times_start() const { return event_times_start; }
+        void reset_event_times();
+#endif
+
         // These modules are available to all other modules
         SerialConsole*    serial;
         StreamOutputPool* streams;
@@ -71,6 +87,7 @@ class Kernel {
         SlowTicker*       slow_ticker;
         StepTicker*       step_ticker;
         Adc*              adc;
+        InputScanner*     input_scanner;
         std::string       current_path;
         uint32_t          base_stepping_frequency;
         uint32_t          acceleration_ticks_per_second;
@@ -78,11 +95,17 @@ class Kernel {
     private:
         // When a module asks to be called for a specific event ( a hook ), this is where that request is remembered
         std::array<std::vector<Module*>, NUMBER_OF_DEFINED_EVENTS> hooks;
+#ifdef EVENT_PROFILE
+        std::array<std::vector<event_time_t>, NUMBER_OF_DEFINED_EVENTS> event_times; // one for each hook
+        uint32_t event_nested_cycles; // cycles of the event handlers called from within the one being timed
+        uint32_t event_times_start;   // us_ticker when they were last reset
+#endif
         struct {
             bool use_leds:1;
             bool halted:1;
             bool grbl_mode:1;
             bool feed_hold:1;
+            bool jog_cancel:1;
             bool ok_per_line:1;
         };
 
@@ -128,8 +128,8 @@ void* MemoryPool::alloc(size_t nbytes)
         // p = p->next
         p = (_poolregion*) (((uint8_t*) p) + p->next);
 
-        // make sure we don't walk off the end
-    } while (p <= (_poolregion*) (((uint8_t*)base) + size));
+        // make sure we don't walk off the end, the last block ends exactly at the end of the region
+    } while (p < (_poolregion*) (((uint8_t*)base) + size));
 
     // fell off the end of the region!
     return NULL;
@@ -173,7 +173,7 @@ void MemoryPool::dealloc(void* d)
                 q->next += p->next;
 
                 // sanity check
-                if ((offset(p) + p->next) >= size)
+                if ((offset(p) + p->next) > size)
                 {
                     // captain, we have a problem!
                     // this can only happen if something has corrupted our heap, since we should simply fail to find a free block if it's full
@@ -18,7 +18,6 @@ const ModuleCallback kernel_callback_functions[NUMBER_OF_DEFINED_EVENTS] = {
     &Module::on_console_line_received,
     &Module::on_gcode_received,
     &Module::on_gcode_execute,
-    &Module::on_speed_change,
     &Module::on_block_begin,
     &Module::on_block_end,
     &Module::on_idle,
@@ -16,7 +16,6 @@ enum _EVENT_ENUM {
     ON_CONSOLE_LINE_RECEIVED,
     ON_GCODE_RECEIVED,
     ON_GCODE_EXECUTE,
-    ON_SPEED_CHANGE,
     ON_BLOCK_BEGIN,
     ON_BLOCK_END,
     ON_IDLE,
@@ -49,7 +48,6 @@ public:
     virtual void on_console_line_received(void *) {};
     virtual void on_gcode_received(void *) {};
     virtual void on_gcode_execute(void *) {};
-    virtual void on_speed_change(void *) {};
     virtual void on_block_begin(void *) {};
     virtual void on_block_end(void *) {};
     virtual void on_idle(void *) {};
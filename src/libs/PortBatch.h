@@ -0,0 +1,88 @@
+#ifndef _PORTBATCH_H
+#define _PORTBATCH_H
+
+#include <stdint.h>
+
+#include "libs/LPC17xx/sLPC17xx.h" // smoothed mbed.h lib
+
+// Pulses a group of output pins with one write per GPIO port. Pins are added once, which finds or makes the entry for
+// their port, then each tick pulse() marks the ones to turn on, output() turns them all on with a FIOSET and/or FIOCLR
+// per port and reset() turns them off again the same way. Pins on the same port change at the same instant. Pulses
+// marked after output() wait for the next one, so a reset() from a higher priority interrupt can't lose them
+class PortBatch
+{
+public:
+    static const int max_ports= 5;
+
+    // where a pin is in the batch, a zero mask is a pin that is not connected and is never pulsed
+    struct pin_t {
+        uint8_t port;
+        uint32_t mask;
+    };
+
+    PortBatch() : n(0)
+    {
+        for (int i = 0; i < max_ports; ++i) {
+            gpio[i]= nullptr;
+            invert[i]= 0;
+            next[i]= 0;
+            pending[i]= 0;
+        }
+    }
+
+    pin_t add(LPC_GPIO_TypeDef *port, uint8_t bit, bool inverting)
+    {
+        pin_t p= {0, 0};
+        if(port == nullptr || bit > 31) return p;
+
+        while(p.port < n && gpio[p.port] != port) p.port++;
+        if(p.port == n) {
+            if(n == max_ports) return p;
+            gpio[n++]= port;
+        }
+
+        p.mask= 1UL << bit;
+        if(inverting) invert[p.port] |= p.mask;
+        else invert[p.port] &= ~p.mask;
+        return p;
+    }
+
+    void pulse(const pin_t &p) { next[p.port] |= p.mask; }
+
+    // set all the pulsed pins active, returns false if there were none
+    bool output()
+    {
+        bool any= false;
+        for (int i = 0; i < n; ++i) {
+            uint32_t m= next[i];
+            if(m == 0) continue;
+            next[i]= 0;
+            if(m & ~invert[i]) gpio[i]->FIOSET= m & ~invert[i];
+            if(m & invert[i]) gpio[i]->FIOCLR= m & invert[i];
+            pending[i] |= m;
+            any= true;
+        }
+        return any;
+    }
+
+    // set all the pulsed pins inactive and start again
+    void reset()
+    {
+        for (int i = 0; i < n; ++i) {
+            uint32_t m= pending[i];
+            if(m == 0) continue;
+            pending[i]= 0;
+            if(m & ~invert[i]) gpio[i]->FIOCLR= m & ~invert[i];
+            if(m & invert[i]) gpio[i]->FIOSET= m & invert[i];
+        }
+    }
+
+private:
+    LPC_GPIO_TypeDef *gpio[max_ports];
+    uint32_t invert[max_ports];
+    uint32_t next[max_ports];
+    volatile uint32_t pending[max_ports];
+    uint8_t n;
+};
+
+#endif /* _PORTBATCH_H */
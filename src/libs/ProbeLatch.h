@@ -0,0 +1,63 @@
+#ifndef _PROBELATCH_H
+#define _PROBELATCH_H
+
+#include <stdint.h>
+
+// Latches where the actuators were at the instant a probe triggered. capture() is called from the probe pin interrupt
+// so the position is exact to the step however fast the probe is moving, rather than wherever the motors had got to by
+// the time a poll noticed the pin. The counters are the actuators' current_position_steps, kept up to date by the step
+// interrupt, so the pin interrupt must not be able to be pre-empted by it or the snapshot could straddle a step
+class ProbeLatch
+{
+public:
+    static const int max_counters= 3;
+
+    ProbeLatch() : n(0), armed(false), latched(false) {}
+
+    // remember where the counters start from and capture on the next edge
+    void arm(const volatile int32_t *const c[], int count)
+    {
+        armed= false;
+        latched= false;
+        n= count > max_counters ? max_counters : count;
+        for (int i = 0; i < n; ++i) {
+            counters[i]= c[i];
+            start[i]= *c[i];
+        }
+        armed= true;
+    }
+
+    void disarm() { armed= false; }
+
+    // the edge turned out to be noise, forget it and wait for the next one
+    void rearm() { latched= false; armed= true; }
+
+    // called from the pin interrupt, returns true if this edge was the one latched
+    bool capture()
+    {
+        if(!armed) return false;
+        for (int i = 0; i < n; ++i) position[i]= *counters[i];
+        armed= false;
+        latched= true;
+        return true;
+    }
+
+    bool is_armed() const { return armed; }
+    bool is_latched() const { return latched; }
+
+    int32_t get_position(int i) const { return position[i]; }
+    // steps counter i had moved from where it was armed when the probe triggered
+    int32_t moved(int i) const { return position[i] - start[i]; }
+    // steps counter i has gone on past the trigger since, it has to step back this many to be where the probe triggered
+    int32_t overrun(int i) const { return *counters[i] - position[i]; }
+
+private:
+    const volatile int32_t *counters[max_counters];
+    int32_t start[max_counters];
+    volatile int32_t position[max_counters];
+    uint8_t n;
+    volatile bool armed;
+    volatile bool latched;
+};
+
+#endif /* _PROBELATCH_H */
@@ -15,6 +15,7 @@ using namespace std;
 #include "libs/Hook.h"
 #include "modules/robot/Conveyor.h"
 #include "Gcode.h"
+#include "IsrProfiler.h"
 
 #include <mri.h>
 
@@ -60,6 +61,7 @@ void SlowTicker::set_frequency( int frequency ){
 
 // The actual interrupt being called by the timer, this is where work is done
 void SlowTicker::tick(){
+    ISR_PROFILE_SCOPE(IsrProfiler::SLOW_TICKER);
 
     // Call all hooks that need to be called ( bresenham )
     for (Hook* hook : this->hooks){
@@ -13,6 +13,7 @@
 #include "libs/Kernel.h"
 #include "StepperMotor.h"
 #include "StreamOutputPool.h"
+#include "IsrProfiler.h"
 #include "system_LPC17xx.h" // mbed.h lib
 #include <math.h>
 #include <mri.h>
@@ -55,14 +56,20 @@ StepTicker::StepTicker(){
 
     // Default start values
     this->a_move_finished = false;
+    this->paused = false;
     this->do_move_finished = 0;
-    this->unstep.reset();
+    this->do_move_switched = false;
+    this->staged_moves = 0;
+    this->staged_from = 0;
     this->set_frequency(100000);
     this->set_reset_delay(100);
     this->set_acceleration_ticks_per_second(1000);
     this->num_motors= 0;
-    this->active_motor.reset();
     this->tick_cnt= 0;
+
+#ifdef ISR_PROFILE
+    IsrProfiler::start();
+#endif
 }
 
 StepTicker::~StepTicker() {
@@ -115,11 +122,54 @@ void StepTicker::synchronize_acceleration(bool fire_now) {
 }
 
 
+// Stop (or restart) the step timer without touching any motor state, used for feed hold.
+// The motors keep their step counts and remaining steps so they carry on exactly where they stopped.
+void StepTicker::set_paused(bool flg)
+{
+    this->paused= flg;
+    if(flg) {
+        LPC_TIM0->TCR = 0;               // Disable interrupt
+    }else if(this->motors.any_active()) {
+        LPC_TIM0->TCR = 1;               // Enable interrupt
+    }
+}
+
+// Publish moves already set up with StepperMotor::stage_move()
+void StepTicker::stage_moves(uint32_t next, uint32_t current)
+{
+    this->staged_from= current;
+    this->staged_moves.store(next);
+}
+
+bool StepTicker::unstage_moves()
+{
+    return this->staged_moves.exchange(0) != 0;
+}
+
+// Called from the step interrupt in a tick where a move finished, start the staged moves if that was the last of the
+// current block's moves. Motors that finished and have no staged move are left to signal_a_move_finished() as usual
+void StepTicker::switch_moves()
+{
+    uint32_t a= this->motors.active;
+    if(a & ~this->staged_from) return; // something else is still moving, or holding the block
+    for (uint32_t m= a; m != 0; m &= m - 1) {
+        if(!this->motor[__builtin_ctz(m)]->is_move_finished) return;
+    }
+
+    uint32_t next= this->staged_moves.exchange(0);
+    for (uint32_t m= next; m != 0; m &= m - 1) {
+        uint32_t i= __builtin_ctz(m);
+        this->motor[i]->start_staged_move();
+        this->motors.set_active(i, true);
+    }
+    if(next != 0) this->do_move_switched= true;
+}
+
 // Call signal_move_finished() on each active motor that asked to be signaled. We do this instead of inside of tick() so that
 // all tick()s are called before we do the move finishing
 void StepTicker::signal_a_move_finished(){
      for (int motor = 0; motor < num_motors; motor++){
-        if (this->active_motor[motor] && this->motor[motor]->is_move_finished){
+        if (this->motors.is_active(motor) && this->motor[motor]->is_move_finished){
             this->motor[motor]->signal_move_finished();
                 // Theoretically this does nothing and the reason for it is currently unknown and/or forgotten
                 // if(this->motor[motor]->moving == false){
@@ -134,12 +184,7 @@ void StepTicker::signal_a_move_finished(){
 
 // Reset step pins on any motor that was stepped
 inline void StepTicker::unstep_tick(){
-    for (int i = 0; i < num_motors; i++) {
-        if(this->unstep[i]){
-            this->motor[i]->unstep();
-        }
-    }
-    this->unstep.reset();
+    this->step_pins.reset();
 }
 
 extern "C" void TIMER1_IRQHandler (void){
@@ -163,6 +208,13 @@ extern "C" void PendSV_Handler(void) {
 
 // slightly lower priority than TIMER0, the whole end of block/start of block is done here allowing the timer to continue ticking
 void StepTicker::PendSV_IRQHandler (void) {
+    ISR_PROFILE_SCOPE(IsrProfiler::PENDSV);
+
+    // the step interrupt already started the next block's moves, let the stepper catch up before anything else finishes
+    if(this->do_move_switched) {
+        this->do_move_switched= false;
+        if(this->move_switched_handler) this->move_switched_handler();
+    }
 
     if(this->do_move_finished.load() > 0) {
         this->do_move_finished--;
@@ -180,6 +232,7 @@ void StepTicker::PendSV_IRQHandler (void) {
 
 // run in RIT lower priority than PendSV
 void  StepTicker::acceleration_tick() {
+    ISR_PROFILE_SCOPE(IsrProfiler::ACCELERATION);
     // call registered acceleration handlers
     for (size_t i = 0; i < acceleration_tick_handlers.size(); ++i) {
         acceleration_tick_handlers[i]();
@@ -187,24 +240,27 @@ void  StepTicker::acceleration_tick() {
 }
 
 void StepTicker::TIMER0_IRQHandler (void){
+    ISR_PROFILE_SCOPE(IsrProfiler::STEP_TICKER);
     // Reset interrupt register
     LPC_TIM0->IR |= 1 << 0;
     tick_cnt++; // count number of ticks
 
-    // Step pins NOTE takes 1.2us when nothing to step, 1.8-2us for one motor stepped and 2.6us when two motors stepped, 3.167us when three motors stepped
-    for (uint32_t motor = 0; motor < num_motors; motor++){
-        // send tick to all active motors
-        if(this->active_motor[motor] && this->motor[motor]->tick()){
-            // we stepped so schedule an unstep
-            this->unstep[motor]= 1;
-        }
-    }
+    // step the motors whose counters reached their period, marking the step pins of the ones that stepped
+    auto on_step= [this](uint32_t i) {
+        if(this->motor[i]->step()) this->step_pins.pulse(this->step_out[i]);
+    };
+#if STEPTICKER_MOTORS > 0
+    this->motors.tick_unrolled<STEPTICKER_MOTORS>(on_step);
+    if(this->num_motors > STEPTICKER_MOTORS) this->motors.tick(STEPTICKER_MOTORS, on_step);
+#else
+    this->motors.tick(0, on_step);
+#endif
 
-    // We may have set a pin on in this tick, now we reset the timer to set it off
+    // Set the step pins of all the motors that stepped, one write per port, then reset the timer to set them off
     // Note there could be a race here if we run another tick before the unsteps have happened,
     // right now it takes about 3-4us but if the unstep were near 10uS or greater it would be an issue
     // also it takes at least 2us to get here so even when set to 1us pulse width it will still be about 3us
-    if( this->unstep.any()){
+    if( this->step_pins.output()){
         LPC_TIM1->TCR = 3;
         LPC_TIM1->TCR = 1;
     }
@@ -215,31 +271,35 @@ void StepTicker::TIMER0_IRQHandler (void){
 
     if(this->a_move_finished) {
         this->a_move_finished= false;
+        // go straight on to the next block if its moves are staged
+        if(this->staged_moves.load() != 0) this->switch_moves();
         this->do_move_finished++; // Note this is an atomic variable because it is updated in two interrupts of different priorities so can be pre-empted
     }
 
     // If a move finished in this tick, we have to tell the actuator to act accordingly
-    if(this->do_move_finished.load() > 0){
+    if(this->do_move_finished.load() > 0 || this->do_move_switched){
         // we delegate the slow stuff to the pendsv handler which will run as soon as this interrupt exits
         //NVIC_SetPendingIRQ(PendSV_IRQn); this doesn't work
         SCB->ICSR = 0x10000000; // SCB_ICSR_PENDSVSET_Msk;
     }
 }
 
-// returns index of the stepper motor in the array and bitset
+// returns index of the stepper motor in the arrays and active mask
 int StepTicker::register_motor(StepperMotor* motor)
 {
-    this->motor.push_back(motor);
-    this->num_motors= this->motor.size();
-    return this->num_motors-1;
+    if(this->num_motors >= StepperArray::max_motors) __debugbreak();
+    Pin &pin= motor->step_pin;
+    this->step_out[num_motors]= step_pins.add(pin.connected() ? pin.port : nullptr, pin.pin, pin.is_inverting());
+    this->motor[num_motors]= motor;
+    return this->num_motors++;
 }
 
 // activate the specified motor, must have been registered
 void StepTicker::add_motor_to_active_list(StepperMotor* motor)
 {
-    bool enabled= active_motor.any(); // see if interrupt was previously enabled
-    active_motor[motor->index]= 1;
-    if(!enabled) {
+    bool enabled= motors.any_active(); // see if interrupt was previously enabled
+    motors.set_active(motor->index, true);
+    if(!enabled && !paused) {
         LPC_TIM0->TCR = 1;               // Enable interrupt
     }
 }
@@ -247,9 +307,9 @@ void StepTicker::add_motor_to_active_list(StepperMotor* motor)
 // Remove a stepper from the list of active motors
 void StepTicker::remove_motor_from_active_list(StepperMotor* motor)
 {
-    active_motor[motor->index]= 0;
+    motors.set_active(motor->index, false);
     // If we have no motor to work on, disable the whole interrupt
-    if(this->active_motor.none()){
+    if(!this->motors.any_active()){
         LPC_TIM0->TCR = 0;               // Disable interrupt
         tick_cnt= 0;
     }
@@ -12,10 +12,19 @@
 
 #include <stdint.h>
 #include <vector>
-#include <bitset>
 #include <functional>
 #include <atomic>
 
+#include "PortBatch.h"
+#include "StepperArray.h"
+
+// Set STEPTICKER_MOTORS to the number of motors the machine has, 3 to 8, to build a step interrupt with the loop over
+// them unrolled. Motors registered beyond that are still ticked, by the generic loop
+#ifndef STEPTICKER_MOTORS
+#define STEPTICKER_MOTORS 0
+#endif
+static_assert(STEPTICKER_MOTORS == 0 || (STEPTICKER_MOTORS >= 3 && STEPTICKER_MOTORS <= 8), "STEPTICKER_MOTORS must be 3 to 8");
+
 class StepperMotor;
 
 class StepTicker{
@@ -44,6 +53,16 @@ class StepTicker{
         void acceleration_tick();
         void synchronize_acceleration(bool fire_now);
 
+        // The motors in the next bitmask have had a move staged, which the step interrupt starts as soon as the motors
+        // in the current bitmask, those of the block now executing, have all finished and no other motor is active.
+        // It then calls the move switched handler from PendSV, which has to catch the rest of the system up
+        void stage_moves(uint32_t next, uint32_t current);
+        bool unstage_moves(); // true if there were staged moves that had not been started
+        bool is_switching_moves() const { return do_move_switched; } // started, but the handler has not been called yet
+        void register_move_switched_handler(std::function<void(void)> cb) { move_switched_handler= cb; }
+        void set_paused(bool flg);
+        bool is_paused() const { return paused; }
+
         void start();
 
         friend class StepperMotor;
@@ -53,13 +72,21 @@ class StepTicker{
         uint32_t period;
         volatile uint32_t tick_cnt;
         std::vector<std::function<void(void)>> acceleration_tick_handlers;
-        std::vector<StepperMotor*> motor;
-        std::bitset<32> active_motor; // limit to 32 motors
-        std::bitset<32> unstep;       // limit to 32 motors
+        std::function<void(void)> move_switched_handler;
+        StepperArray motors;          // the per tick state of all the motors
+        StepperMotor* motor[StepperArray::max_motors];
+        PortBatch::pin_t step_out[StepperArray::max_motors];
+        PortBatch step_pins;          // step pins of all the motors grouped by port
         std::atomic_uchar do_move_finished;
+        std::atomic_uint staged_moves; // motors with a staged move
+        uint32_t staged_from;          // motors that have to finish before the staged moves start
 
         uint8_t num_motors;
+        void switch_moves();
+
         volatile bool a_move_finished;
+        volatile bool do_move_switched;
+        volatile bool paused;
 };
 
 
@@ -0,0 +1,69 @@
+#ifndef _STEPPERARRAY_H
+#define _STEPPERARRAY_H
+
+#include <stdint.h>
+
+// The state the step interrupt looks at for every motor on every tick, kept as an array per field rather than in each
+// StepperMotor so the tick walks a few contiguous words instead of chasing a pointer per motor. Each active motor
+// advances its 18:14 fixed point counter by one tick and on_step(i) is called when it reaches the motor's period, it is
+// up to on_step to take the period back off.
+// tick() visits the active motors from a bitmask, tick_unrolled<N>() is the same for motors 0 to N-1 with the loop
+// unrolled at compile time for a build with a known number of motors
+class StepperArray
+{
+public:
+    static const uint32_t max_motors= 32;
+    static const uint32_t fx_shift= 14;
+    static const uint32_t fx_increment= ((uint32_t)1 << fx_shift);
+
+    StepperArray() : active(0)
+    {
+        for (uint32_t i = 0; i < max_motors; ++i) {
+            fx_counter[i]= 0;
+            fx_ticks_per_step[i]= 0xFFFFF000UL;
+        }
+    }
+
+    bool is_active(uint32_t i) const { return (active >> i) & 1; }
+    void set_active(uint32_t i, bool flg) { if(flg) active |= (1UL << i); else active &= ~(1UL << i); }
+    bool any_active() const { return active != 0; }
+
+    // tick the active motors from first on
+    template<typename F> inline void tick(uint32_t first, F on_step)
+    {
+        if(first >= max_motors) return;
+        uint32_t a= active & (0xFFFFFFFFUL << first);
+        while(a != 0) {
+            uint32_t i= __builtin_ctz(a);
+            a &= a - 1;
+            if((fx_counter[i] += fx_increment) >= fx_ticks_per_step[i]) on_step(i);
+        }
+    }
+
+    // tick the active motors of 0 to N-1
+    template<uint32_t N, typename F> inline void tick_unrolled(F on_step)
+    {
+        static_assert(N <= max_motors, "too many motors");
+        Unroll<0, N>::tick(*this, active, on_step);
+    }
+
+    uint32_t fx_counter[max_motors];        // ticks since the last step, fixed point
+    uint32_t fx_ticks_per_step[max_motors]; // ticks between steps, fixed point
+    volatile uint32_t active;               // bit per motor that is ticked
+
+private:
+    template<uint32_t I, uint32_t N> struct Unroll {
+        template<typename F> __attribute__((always_inline)) static inline void tick(StepperArray &s, uint32_t a, F &on_step)
+        {
+            if(a & (1UL << I)) {
+                if((s.fx_counter[I] += fx_increment) >= s.fx_ticks_per_step[I]) on_step(I);
+            }
+            Unroll<I + 1, N>::tick(s, a, on_step);
+        }
+    };
+    template<uint32_t N> struct Unroll<N, N> {
+        template<typename F> static inline void tick(StepperArray &, uint32_t, F &) {}
+    };
+};
+
+#endif /* _STEPPERARRAY_H */
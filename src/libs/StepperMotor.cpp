@@ -37,15 +37,21 @@ void StepperMotor::init()
 {
     // register this motor with the step ticker, and get its index in that array and bit position
     this->index= THEKERNEL->step_ticker->register_motor(this);
+    this->fx_counter= &THEKERNEL->step_ticker->motors.fx_counter[this->index];
+    this->fx_ticks_per_step= &THEKERNEL->step_ticker->motors.fx_ticks_per_step[this->index];
     this->moving = false;
-    this->fx_counter = 0;
-    this->fx_ticks_per_step = 0xFFFFF000UL; // some big number so we don't start stepping before it is set
+    *this->fx_counter = 0;
+    *this->fx_ticks_per_step = 0xFFFFF000UL; // some big number so we don't start stepping before it is set
     this->stepped = 0;
     this->steps_to_move = 0;
     this->is_move_finished = false;
     this->last_step_tick_valid= false;
     this->last_step_tick= 0;
     this->force_finish= false;
+    this->stop_pin= nullptr;
+    this->stop_debounce= 1;
+    this->stop_hits= 0;
+    this->stopped_by_pin= false;
 
     steps_per_mm         = 1.0F;
     max_rate             = 50.0F;
@@ -55,23 +61,36 @@ void StepperMotor::init()
     last_milestone_mm    = 0.0F;
     current_position_steps= 0;
     signal_step= 0;
+    staged_steps= 0;
+    staged_fx_ticks_per_step= 0xFFFFF000UL;
+    staged_speed= 0.0F;
+    staged_direction= false;
 }
 
 
-// This is called ( see the .h file, we had to put a part of things there for obscure inline reasons ) when a step has to be generated
+// This is called by the step ticker when the motor's counter reaches its period and a step has to be generated
 // we also here check if the move is finished etc ..
 // This is in highest priority interrupt so cannot be pre-empted
-void StepperMotor::step()
+// Returns true if the step pin is to be set, the step ticker sets the pins of all the motors that step in a tick together
+bool StepperMotor::step()
 {
     // ignore if we are still processing the end of a block
-    if(this->is_move_finished) return;
-
-    if(!this->force_finish) {
-        // output to pins 37t
-        this->step_pin.set( 1 );
+    if(this->is_move_finished) return false;
+
+    // homing, sample the endstop before each step so the axis stops within one step of it triggering
+    if(this->stop_pin != nullptr && !this->force_finish) {
+        if(!this->stop_pin->get()) {
+            this->stop_hits= 0;
+        } else if(++this->stop_hits >= this->stop_debounce) {
+            this->force_finish= true;
+            this->stopped_by_pin= true;
+        }
+    }
 
+    bool stepped_now= !this->force_finish;
+    if(stepped_now) {
         // move counter back 11t
-        this->fx_counter -= this->fx_ticks_per_step;
+        *this->fx_counter -= *this->fx_ticks_per_step;
 
         // we have moved a step 9t
         this->stepped++;
@@ -95,6 +114,7 @@ void StepperMotor::step()
         this->last_step_tick= THEKERNEL->step_ticker->get_tick_cnt(); // remember when last step was
         if(this->force_finish) this->steps_to_move = stepped;
     }
+    return stepped_now;
 }
 
 // If the move is finished, the StepTicker will call this ( because we asked it to in tick() )
@@ -135,13 +155,31 @@ StepperMotor* StepperMotor::move( bool direction, unsigned int steps, float init
     this->dir_pin.set(direction);
     this->direction = direction;
     this->force_finish= false;
+    this->stopped_by_pin= false;
+    this->stop_hits= 0;
 
     // How many steps we have to move until the move is done
     this->steps_to_move = steps;
 
     // Zero our tool counters
+    *this->fx_ticks_per_step = 0xFFFFF000UL; // some big number so we don't start stepping before it is set again
+    this->reset_counters();
+
+    // Starting now we are moving
+    if( steps > 0 ) {
+        if(initial_speed >= 0.0F) set_speed(initial_speed);
+        this->moving = true;
+    } else {
+        this->moving = false;
+    }
+    this->update_exit_tick();
+    return this;
+}
+
+// Start counting a new move from no steps
+void StepperMotor::reset_counters()
+{
     this->stepped = 0;
-    this->fx_ticks_per_step = 0xFFFFF000UL; // some big number so we don't start stepping before it is set again
     if(this->last_step_tick_valid) {
         // we set this based on when the last step was, thus compensating for missed ticks
         uint32_t ts= THEKERNEL->step_ticker->ticks_since(this->last_step_tick);
@@ -151,20 +189,43 @@ StepperMotor* StepperMotor::move( bool direction, unsigned int steps, float init
         // TODO we may need to set this based on the current step rate, trouble is we don't know what that is yet, we could use the last fx_ticks_per_step as a guide
         if(ts > 5) ts= 5; // limit to 50us catch up around 1-2 steps
         else if(ts > 15) ts= 0; // no way to know what the delay was
-        this->fx_counter= ts*fx_increment;
+        *this->fx_counter= ts*fx_increment;
     }else{
-        this->fx_counter = 0; // set to zero as there was no step last block
+        *this->fx_counter = 0; // set to zero as there was no step last block
     }
+}
 
-    // Starting now we are moving
-    if( steps > 0 ) {
-        if(initial_speed >= 0.0F) set_speed(initial_speed);
-        this->moving = true;
-    } else {
-        this->moving = false;
-    }
-    this->update_exit_tick();
-    return this;
+// Set up the move that the step ticker starts by itself the moment the current block's moves finish, so the next block
+// does not wait for the end of block events to get to Stepper
+void StepperMotor::stage_move(bool direction, uint32_t steps, float speed)
+{
+    if(speed < minimum_step_rate) speed= minimum_step_rate;
+    this->staged_direction= direction;
+    this->staged_steps= steps;
+    this->staged_speed= speed;
+    this->staged_fx_ticks_per_step= speed_to_fx_ticks(speed);
+}
+
+// Called by the step ticker in the step interrupt, the same as move() with the staged values
+void StepperMotor::start_staged_move()
+{
+    this->dir_pin.set(this->staged_direction);
+    this->direction= this->staged_direction;
+    this->force_finish= false;
+    this->stopped_by_pin= false;
+    this->stop_hits= 0;
+    this->signal_step= 0;
+    this->steps_to_move= this->staged_steps;
+    this->steps_per_second= this->staged_speed;
+    *this->fx_ticks_per_step= this->staged_fx_ticks_per_step;
+    this->reset_counters();
+    this->moving= true;
+    this->is_move_finished= false;
+}
+
+uint32_t StepperMotor::speed_to_fx_ticks(float speed)
+{
+    return floor(fx_increment * THEKERNEL->step_ticker->get_frequency() / speed);
 }
 
 // Set the speed at which this stepper moves in steps/sec, should be called set_step_rate()
@@ -187,7 +248,7 @@ StepperMotor* StepperMotor::set_speed( float speed )
     this->steps_per_second = speed;
 
     // set the new speed, NOTE this can be pre-empted by stepticker so the following write needs to be atomic
-    this->fx_ticks_per_step= floor(fx_increment * THEKERNEL->step_ticker->get_frequency() / speed);
+    *this->fx_ticks_per_step= speed_to_fx_ticks(speed);
     return this;
 }
 
@@ -10,6 +10,7 @@
 
 #include "libs/Hook.h"
 #include "Pin.h"
+#include "StepperArray.h"
 #include <atomic>
 #include <functional>
 
@@ -22,8 +23,7 @@ class StepperMotor {
         StepperMotor(Pin& step, Pin& dir, Pin& en);
         ~StepperMotor();
 
-        void step();
-        inline void unstep() { step_pin.set(0); };
+        bool step();
 
         inline void enable(bool state) { en_pin.set(!state); };
 
@@ -33,6 +33,8 @@ class StepperMotor {
         StepperMotor* move( bool direction, unsigned int steps, float initial_speed= -1.0F);
         void signal_move_finished();
         StepperMotor* set_speed( float speed );
+        // the move to start when the step ticker switches blocks, see StepTicker::stage_moves()
+        void stage_move(bool direction, uint32_t steps, float speed);
         void set_moved_last_block(bool flg) { last_step_tick_valid= flg; }
         void update_exit_tick();
 
@@ -42,6 +44,8 @@ class StepperMotor {
         void change_last_milestone(float);
         float get_last_milestone(void) const { return last_milestone_mm; }
         float get_current_position(void) const { return (float)current_position_steps/steps_per_mm; }
+        // the step counter itself, for code that has to read the position from an interrupt
+        const volatile int32_t *get_position_counter(void) const { return &current_position_steps; }
         float get_max_rate(void) const { return max_rate; }
         void set_max_rate(float mr) { max_rate= mr; }
         float get_min_rate(void) const { return minimum_step_rate; }
@@ -51,6 +55,9 @@ class StepperMotor {
         uint32_t get_steps_to_move() const { return steps_to_move; }
         uint32_t get_stepped() const { return stepped; }
         void force_finish_move() { force_finish= true; }
+        // finish the move before the next step once pin has read active on debounce steps in a row, nullptr to stop checking
+        void set_stop_pin(Pin *pin, uint8_t debounce= 1) { stop_hits= 0; stop_debounce= debounce; stop_pin= pin; }
+        bool was_stopped_by_pin() const { return stopped_by_pin; }
 
         template<typename T> void attach( T *optr, uint32_t ( T::*fptr )( uint32_t ) ){
             Hook* hook = new Hook();
@@ -65,6 +72,9 @@ class StepperMotor {
 
     private:
         void init();
+        uint32_t speed_to_fx_ticks(float speed);
+        void reset_counters();
+        void start_staged_move();
 
         int index;
         Hook* end_hook;
@@ -72,6 +82,9 @@ class StepperMotor {
         Pin step_pin;
         Pin dir_pin;
         Pin en_pin;
+        Pin *stop_pin;
+        uint8_t stop_debounce;
+        uint8_t stop_hits;
 
         float steps_per_second;
         float steps_per_mm;
@@ -88,11 +101,16 @@ class StepperMotor {
         uint32_t last_step_tick;
         uint32_t signal_step;
 
-        // set to 32 bit fixed point, 18:14 bits fractional
-        static const uint32_t fx_shift= 14;
-        static const uint32_t fx_increment= ((uint32_t)1<<fx_shift);
-        uint32_t fx_counter;
-        uint32_t fx_ticks_per_step;
+        // set to 32 bit fixed point, 18:14 bits fractional, these are this motor's entries in the step ticker's arrays
+        static const uint32_t fx_shift= StepperArray::fx_shift;
+        static const uint32_t fx_increment= StepperArray::fx_increment;
+        uint32_t *fx_counter;
+        uint32_t *fx_ticks_per_step;
+
+        uint32_t staged_steps;
+        uint32_t staged_fx_ticks_per_step;
+        float staged_speed;
+        bool staged_direction;
 
         volatile struct {
             volatile bool is_move_finished:1; // Whether the move just finished
@@ -100,19 +118,7 @@ class StepperMotor {
             volatile bool force_finish:1; // set to force a move to finish early
             bool direction:1;
             bool last_step_tick_valid:1; // set if the last step tick time is valid (ie the motor moved last block)
-        };
-
-        // Called a great many times per second, to step if we have to now
-        inline bool tick() {
-            // increase the ( 32 fixed point 18:14 ) counter by one tick 11t
-            fx_counter += fx_increment;
-
-            // if we are to step now
-            if (fx_counter >= fx_ticks_per_step){
-                step();
-                return true;
-            }
-            return false;
+            volatile bool stopped_by_pin:1; // the last move was ended by the stop pin
         };
 };
 
@@ -209,6 +209,11 @@ bool USBSerial::USBEvent_EPOut(uint8_t bEP, uint8_t bEPStatus)
             continue;
         }
 
+        if(c[i] == 0x85){ // jog cancel, same code as grbl uses
+            THEKERNEL->set_jog_cancel(true);
+            continue;
+        }
+
         if(THEKERNEL->is_grbl_mode()) {
             if(c[i] == '!'){ // safe pause
                 THEKERNEL->set_feed_hold(true);
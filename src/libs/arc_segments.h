@@ -0,0 +1,21 @@
+#ifndef _ARC_SEGMENTS_H
+#define _ARC_SEGMENTS_H
+
+#include <stdint.h>
+#include <math.h>
+
+// The fewest chords an arc of the given radius sweeping angular_travel radians can be cut into so that none strays
+// more than max_error from it. The chord of a segment spanning angle theta is at most radius*(1-cos(theta/2)) from the
+// arc, so big arcs get long segments and small arcs short ones. That is 2*radius*sin(theta/4)^2, which unlike the
+// cosine keeps its precision in a float when the error is tiny next to the radius. When the error is too small to
+// resolve at all the count is as high as it can go rather than overflowing
+static inline uint16_t arc_segments_for_error(float angular_travel, float radius, float max_error)
+{
+    float h = max_error / (2.0F * radius);
+    float max_theta = (h < 1.0F) ? 4.0F * asinf(sqrtf(h)) : 2.0F * (float)M_PI;
+    float segments = ceilf(fabsf(angular_travel) / max_theta);
+    if(!(segments < 65535.0F)) return 65535;
+    return segments < 1.0F ? 1 : (uint16_t)segments;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef _FAST_TRIG_H
+#define _FAST_TRIG_H
+
+#include <math.h>
+
+// Polynomial approximations of the inverse trig the non cartesian arm solutions need, for when the soft float
+// library versions are too slow for the segment rate wanted.
+// atan is Abramowitz and Stegun 4.4.49, error no more than 1.2e-5 radians (0.0007 degrees) over the whole range once
+// float rounding is added in, which is 1/40th of a step on an arm with 35 steps per degree.
+
+// atan(x) for -1 <= x <= 1
+static inline float fast_atan_unit(float x)
+{
+    float x2 = x * x;
+    return x * (0.9998660F + x2 * (-0.3302995F + x2 * (0.1801410F + x2 * (-0.0851330F + x2 * 0.0208351F))));
+}
+
+static inline float fast_atanf(float x)
+{
+    if(x > 1.0F) return (float)M_PI_2 - fast_atan_unit(1.0F / x);
+    if(x < -1.0F) return -(float)M_PI_2 - fast_atan_unit(1.0F / x);
+    return fast_atan_unit(x);
+}
+
+static inline float fast_atan2f(float y, float x)
+{
+    if(x == 0.0F && y == 0.0F) return 0.0F;
+
+    float a;
+    if(fabsf(x) >= fabsf(y)) {
+        a = fast_atan_unit(y / x);
+        if(x < 0.0F) a += (y < 0.0F) ? -(float)M_PI : (float)M_PI;
+    } else {
+        a = ((y > 0.0F) ? (float)M_PI_2 : -(float)M_PI_2) - fast_atan_unit(x / y);
+    }
+    return a;
+}
+
+#endif
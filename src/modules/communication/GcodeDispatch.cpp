@@ -201,7 +201,7 @@ try_again:
                         }
 
                         // remember last modal group 1 code
-                        if(gcode->g < 4) {
+                        if(gcode->g < 4 || gcode->g == 5) {
                             modal_group_1= gcode->g;
                         }
                     }
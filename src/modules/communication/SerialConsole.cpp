@@ -12,7 +12,7 @@ using std::string;
 #include "libs/Kernel.h"
 #include "libs/nuts_bolts.h"
 #include "SerialConsole.h"
-#include "libs/RingBuffer.h"
+#include "libs/HeapRing.h"
 #include "libs/SerialMessage.h"
 #include "libs/StreamOutput.h"
 #include "libs/StreamOutputPool.h"
@@ -20,7 +20,7 @@ using std::string;
 // Serial reading module
 // Treats every received line as a command and passes it ( via event call ) to the command dispatcher.
 // The command dispatcher will then ask other modules if they can do something with it
-SerialConsole::SerialConsole( PinName rx_pin, PinName tx_pin, int baud_rate ){
+SerialConsole::SerialConsole( PinName rx_pin, PinName tx_pin, int baud_rate ) : buffer(256) {
     this->serial = new mbed::Serial( rx_pin, tx_pin );
     this->serial->baud(baud_rate);
 }
@@ -31,6 +31,7 @@ void SerialConsole::on_module_loaded() {
     this->serial->attach(this, &SerialConsole::on_serial_char_received, mbed::Serial::RxIrq);
     query_flag= false;
     halt_flag= false;
+    discard_flag= false;
 
     // We only call the command dispatcher in the main loop, nowhere else
     this->register_for_event(ON_MAIN_LOOP);
@@ -52,9 +53,26 @@ void SerialConsole::on_serial_char_received(){
             halt_flag= true;
             continue;
         }
+        if(received == (char)0x85) { // jog cancel
+            THEKERNEL->set_jog_cancel(true);
+            continue;
+        }
+        // a NUL marks a cut line in the buffer, so one that is received is dropped
+        if( received == '\0' ) continue;
         // convert CR to NL (for host OSs that don't send NL)
         if( received == '\r' ){ received = '\n'; }
-        this->buffer.push_back(received);
+        if( received == '\n' ){
+            discard_flag= false;
+        }else if( discard_flag ){
+            continue;
+        }else if( this->buffer.size() + 2 >= this->buffer.capacity() ){
+            // a line too long for the buffer has the rest of it thrown away, the last two slots are kept for a NUL to
+            // mark it and the newline to end it, so the main loop can reject it rather than run what was left of it
+            discard_flag= true;
+            this->buffer.push('\0');
+            continue;
+        }
+        this->buffer.push(received);
     }
 }
 
@@ -75,15 +93,22 @@ void SerialConsole::on_main_loop(void * argument){
     if( this->has_char('\n') ){
         string received;
         received.reserve(20);
+        bool too_long= false;
         while(1){
            char c;
-           this->buffer.pop_front(c);
+           this->buffer.pop(c);
            if( c == '\n' ){
+                if(too_long) {
+                    this->printf("error:line too long, ignored\n");
+                    return;
+                }
                 struct SerialMessage message;
                 message.message = received;
                 message.stream = this;
                 THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message );
                 return;
+            }else if( c == '\0' ){
+                too_long= true;
             }else{
                 received += c;
             }
@@ -109,12 +134,13 @@ int SerialConsole::_getc()
 
 // Does the queue have a given char ?
 bool SerialConsole::has_char(char letter){
-    int index = this->buffer.tail;
-    while( index != this->buffer.head ){
-        if( this->buffer.buffer[index] == letter ){
+    for( unsigned int i = 0, n = this->buffer.size(); i < n; i++ ){
+        if( this->buffer.peek(i) == letter ){
             return true;
         }
-        index = this->buffer.next_block_index(index);
     }
     return false;
 }
+
+#include "HeapRing.cpp"
+template class HeapRing<char>;
@@ -14,7 +14,7 @@
 #include <vector>
 #include <string>
 using std::string;
-#include "libs/RingBuffer.h"
+#include "libs/HeapRing.h"
 #include "libs/StreamOutput.h"
 
 
@@ -36,12 +36,13 @@ class SerialConsole : public Module, public StreamOutput {
 
         //string receive_buffer;                 // Received chars are stored here until a newline character is received
         //vector<std::string> received_lines;    // Received lines are stored here until they are requested
-        RingBuffer<char,256> buffer;             // Receive buffer
+        HeapRing<char> buffer;                   // Receive buffer, filled by the RX interrupt
         mbed::Serial* serial;
         struct {
           bool query_flag:1;
           bool halt_flag:1;
         };
+        bool discard_flag;                       // the rest of an over-long line is being thrown away, RX interrupt only
 };
 
 #endif
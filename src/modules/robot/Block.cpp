@@ -129,6 +129,50 @@ void Block::calculate_trapezoid( float entryspeed, float exitspeed )
     this->exit_speed = exitspeed;
 }
 
+/* Recalculates the trapezoid for the rest of a block that was stopped part way through by a feed hold.
+// The block is currently executing so the planner will not touch it, we restart from rest at steps_completed
+// and must still reach final_rate at the end of the block. If the remaining distance is too short to get back up to
+// final_rate then final_rate and exit_speed are lowered, and the planner must then replan the blocks that follow.
+//                                           +------+ <- nominal_rate
+//                                          /        \
+//                                         /          + <- final_rate
+//            +--- held at here ---------> +----------+
+//                                   steps_completed
+*/
+void Block::calculate_resume_trapezoid( uint32_t steps_completed )
+{
+    if (steps_completed >= this->steps_event_count)
+        return;
+
+    uint32_t steps_remaining = this->steps_event_count - steps_completed;
+    float acceleration_per_second = this->rate_delta * THEKERNEL->acceleration_ticks_per_second; // ( step/s^2)
+
+    // we start from (almost) stationary, ie the first acceleration tick
+    this->initial_rate = ceilf(this->rate_delta);
+
+    // make sure we can still get back up to the exit rate in the distance left
+    float max_final_rate = sqrtf(2.0F * acceleration_per_second * steps_remaining);
+    if (this->final_rate > max_final_rate) {
+        this->final_rate = floorf(max_final_rate);
+        this->exit_speed = this->nominal_speed * this->final_rate / this->nominal_rate;
+    }
+
+    int accelerate_steps = ceilf( this->estimate_acceleration_distance( this->initial_rate, this->nominal_rate, acceleration_per_second ) );
+    int decelerate_steps = floorf( this->estimate_acceleration_distance( this->nominal_rate, this->final_rate,  -acceleration_per_second ) );
+    int plateau_steps = steps_remaining - accelerate_steps - decelerate_steps;
+
+    if (plateau_steps < 0) {
+        accelerate_steps = ceilf(this->intersection_distance(this->initial_rate, this->final_rate, acceleration_per_second, steps_remaining));
+        accelerate_steps = max( accelerate_steps, 0 );
+        accelerate_steps = min( accelerate_steps, int(steps_remaining) );
+        plateau_steps = 0;
+    }
+
+    // these are compared against the total steps taken so far in this block so are offset by what has already been done
+    this->accelerate_until = steps_completed + accelerate_steps;
+    this->decelerate_after = steps_completed + accelerate_steps + plateau_steps;
+}
+
 // Calculates the distance (not time) it takes to accelerate from initial_rate to target_rate using the
 // given acceleration:
 float Block::estimate_acceleration_distance(float initialrate, float targetrate, float acceleration)
@@ -18,6 +18,7 @@ class Block {
     public:
         Block();
         void calculate_trapezoid( float entry_speed, float exit_speed );
+        void calculate_resume_trapezoid( uint32_t steps_completed );
         float estimate_acceleration_distance( float initial_rate, float target_rate, float acceleration );
         float intersection_distance(float initial_rate, float final_rate, float acceleration, float distance);
         float max_allowable_speed( float acceleration, float target_velocity, float distance);
@@ -14,6 +14,7 @@ using namespace std;
 #include "libs/Kernel.h"
 #include "Timer.h" // mbed.h lib
 #include "wait_api.h" // mbed.h lib
+#include "us_ticker_api.h" // mbed.h lib
 #include "Block.h"
 #include "Conveyor.h"
 #include "Planner.h"
@@ -57,6 +58,7 @@ Conveyor::Conveyor(){
     running = false;
     flush = false;
     halted= false;
+    waiting= false;
 }
 
 void Conveyor::on_module_loaded(){
@@ -131,6 +133,7 @@ void Conveyor::on_main_loop(void*)
 
 void Conveyor::on_config_reload(void* argument)
 {
+    // rounded down to a power of two
     queue.resize(THEKERNEL->config->value(planner_queue_size_checksum)->by_default(32)->as_number());
 }
 
@@ -152,17 +155,18 @@ void Conveyor::on_block_end(void* block)
 
     gc_pending = queue.next(gc_pending);
 
+    // the blocks up to head are the ones the main loop has finished preparing
+    unsigned int head = queue.load_head();
+
     // mark entire queue for GC if flush flag is asserted
-    if (flush){
-        while (gc_pending != queue.head_i) {
-            gc_pending = queue.next(gc_pending);
-        }
-    }
+    if (flush)
+        gc_pending = head;
 
     // Return if queue is empty
-    if (gc_pending == queue.head_i)
+    if (gc_pending == head)
     {
         running = false;
+        queue_stats.ran_dry(us_ticker_read(), waiting || flush || halted);
         return;
     }
 
@@ -175,10 +179,31 @@ void Conveyor::on_block_end(void* block)
 // Wait for the queue to be empty
 void Conveyor::wait_for_empty_queue()
 {
+    bool was_waiting= waiting;
+    waiting= true;
     while (!queue.is_empty()) {
         ensure_running();
         THEKERNEL->call_event(ON_IDLE, this);
     }
+    waiting= was_waiting;
+}
+
+// number of blocks queued that have not yet finished executing, including the current one
+unsigned int Conveyor::queued_blocks()
+{
+    return (queue.head_i - gc_pending) & queue.mask;
+}
+
+// the block queued to run after the given one if that is the one executing, nullptr if there is none yet
+Block *Conveyor::get_block_after(const Block *block)
+{
+    unsigned int g= gc_pending;
+    unsigned int head= queue.load_head();
+    if (g == head || queue.item_ref(g) != block)
+        return nullptr;
+
+    unsigned int n= queue.next(g);
+    return n == head ? nullptr : queue.item_ref(n);
 }
 
 /*
@@ -200,6 +225,7 @@ void Conveyor::queue_head_block()
     }else{
         queue.head_ref()->ready();
         queue.produce_head();
+        queue_stats.appended(queued_blocks(), queue.is_full());
     }
 }
 
@@ -211,6 +237,7 @@ void Conveyor::ensure_running()
             return;
 
         running = true;
+        queue_stats.restarted(us_ticker_read());
         queue.item_ref(gc_pending)->begin();
     }
 }
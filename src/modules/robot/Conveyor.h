@@ -10,6 +10,7 @@
 
 #include "libs/Module.h"
 #include "HeapRing.h"
+#include "QueueStats.h"
 
 using namespace std;
 #include <string>
@@ -35,6 +36,8 @@ public:
     void wait_for_empty_queue();
     bool is_queue_empty() { return queue.is_empty(); };
     bool is_queue_full() { return queue.is_full(); };
+    unsigned int queued_blocks();
+    Block *get_block_after(const Block *);
 
     void ensure_running(void);
 
@@ -44,6 +47,8 @@ public:
     void dump_queue(void);
     void flush_queue(void);
     bool is_flushing() const { return flush; }
+    bool is_waiting() const { return waiting; } // something is waiting in wait_for_empty_queue()
+    QueueStats& get_queue_stats() { return queue_stats; }
 
     friend class Planner; // for queue
 
@@ -52,6 +57,11 @@ private:
 
     Queue_t queue;  // Queue of Blocks
     volatile unsigned int gc_pending;
+    QueueStats queue_stats;
+
+    // waiting for the queue to empty, so it running dry is not an underrun. Written by the main loop on every wait, so
+    // it is kept out of the bitfield below that on_block_end() writes running in
+    volatile bool waiting;
 
     struct {
         volatile bool running:1;
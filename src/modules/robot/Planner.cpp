@@ -31,6 +31,7 @@ using namespace std;
 #define junction_deviation_checksum    CHECKSUM("junction_deviation")
 #define z_junction_deviation_checksum  CHECKSUM("z_junction_deviation")
 #define minimum_planner_speed_checksum CHECKSUM("minimum_planner_speed")
+#define planner_slowdown_time_checksum CHECKSUM("planner_slowdown_time")
 
 // The Planner does the acceleration math for the queue of Blocks ( movements ).
 // It makes sure the speed stays within the configured constraints ( acceleration, junction_deviation, etc )
@@ -39,6 +40,7 @@ using namespace std;
 Planner::Planner()
 {
     clear_vector_float(this->previous_unit_vec);
+    this->slowdown_queued= 0;
     config_load();
 }
 
@@ -51,11 +53,14 @@ void Planner::config_load()
     this->junction_deviation = THEKERNEL->config->value(junction_deviation_checksum)->by_default(0.05F)->as_number();
     this->z_junction_deviation = THEKERNEL->config->value(z_junction_deviation_checksum)->by_default(-1)->as_number(); // disabled by default
     this->minimum_planner_speed = THEKERNEL->config->value(minimum_planner_speed_checksum)->by_default(0.0f)->as_number();
+    this->slowdown_time = THEKERNEL->config->value(planner_slowdown_time_checksum)->by_default(0.0f)->as_number(); // disabled by default
 }
 
 
 // Append a block to the queue, compute it's speed factors
-void Planner::append_block( ActuatorCoordinates &actuator_pos, float rate_mm_s, float distance, float unit_vec[] )
+// curve_radius is set when the block continues a tangent continuous curve (eg G5) from the previous block, it is the radius
+// of curvature of the path at the junction (INFINITY if straight there) and the junction speed is also held to its centripetal limit
+void Planner::append_block( ActuatorCoordinates &actuator_pos, float rate_mm_s, float distance, float unit_vec[], float curve_radius )
 {
     float acceleration, junction_deviation;
 
@@ -97,6 +102,13 @@ void Planner::append_block( ActuatorCoordinates &actuator_pos, float rate_mm_s,
 
     block->millimeters = distance;
 
+    // when the queue is getting shallow slow short blocks down so it does not run dry
+    if(this->slowdown_time > 0.0F) {
+        unsigned int queued= THEKERNEL->conveyor->queued_blocks();
+        rate_mm_s = slowdown_rate(rate_mm_s, distance, queued, this->slowdown_queued, THEKERNEL->conveyor->queue.length, this->slowdown_time);
+        this->slowdown_queued= queued;
+    }
+
     // Calculate speed in mm/sec for each axis. No divide by zero due to previous checks.
     // NOTE: Minimum stepper speed is limited by MINIMUM_STEPS_PER_MINUTE in stepper.c
     if( distance > 0.0F ) {
@@ -152,6 +164,12 @@ void Planner::append_block( ActuatorCoordinates &actuator_pos, float rate_mm_s,
             }
         }
     }
+
+    // the chords of a finely flattened curve turn so little that the junction deviation does not limit them at all,
+    // so also limit to the speed that keeps the centripetal acceleration around the real curve within acceleration
+    if (curve_radius > 0.0F && !isinf(curve_radius)) {
+        vmax_junction = min(vmax_junction, sqrtf(acceleration * curve_radius));
+    }
     block->max_entry_speed = vmax_junction;
 
     // Initialize block entry speed. Compute based on deceleration to user-defined minimum_planner_speed.
@@ -271,6 +289,43 @@ void Planner::recalculate()
     current->calculate_trapezoid(current->entry_speed, minimum_planner_speed);
 }
 
+/*
+ * After a feed hold the executing block is restarted from rest, if it was held too close to its end it
+ * cannot get back up to its planned exit speed, so the blocks following it have to enter slower.
+ * We walk forward from the executing block lowering entry speeds until the plan is reachable again.
+ * Blocks we touch get their recalculate flag cleared so a subsequent reverse pass cannot raise them back up.
+ * NOTE must only be called while the stepper is held, so no block can begin or end while we do this.
+ */
+void Planner::replan_after_hold()
+{
+    Conveyor::Queue_t &queue = THEKERNEL->conveyor->queue;
+
+    unsigned int block_index = THEKERNEL->conveyor->gc_pending;
+    float exit_speed = queue.item_ref(block_index)->exit_speed;
+
+    while (block_index != queue.head_i) {
+        block_index = queue.next(block_index);
+        Block *current = queue.item_ref(block_index);
+
+        // the head block is only part of the plan if it is ready and waiting for room in the queue
+        if (!current->is_ready || current->entry_speed <= exit_speed)
+            break;
+
+        current->entry_speed = exit_speed;
+        current->recalculate_flag = false;
+
+        float next_entry_speed = minimum_planner_speed;
+        if (block_index != queue.head_i) {
+            Block *next = queue.item_ref(queue.next(block_index));
+            if (next->is_ready)
+                next_entry_speed = next->entry_speed;
+        }
+
+        exit_speed = min(next_entry_speed, current->max_exit_speed());
+        current->calculate_trapezoid(current->entry_speed, exit_speed);
+    }
+}
+
 
 // Calculates the maximum allowable speed at this point when you must be able to reach target_velocity using the
 // acceleration within the allotted distance.
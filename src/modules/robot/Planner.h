@@ -15,14 +15,30 @@ class Planner
 {
 public:
     Planner();
-    void append_block(ActuatorCoordinates &target, float rate_mm_s, float distance, float unit_vec[] );
+    void append_block(ActuatorCoordinates &target, float rate_mm_s, float distance, float unit_vec[], float curve_radius= 0.0F );
     float max_allowable_speed( float acceleration, float target_velocity, float distance);
     void recalculate();
+    void replan_after_hold();
     Block *get_current_block();
     void cleanup_queue();
     float get_acceleration() const { return acceleration; }
     float get_z_acceleration() const { return z_acceleration > 0.0F ? z_acceleration : acceleration; }
 
+    // The rate to plan a block at so the queue does not run dry. With fewer than half of queue_size blocks queued a block
+    // that would take less than min_time is slowed towards taking min_time, more so the fewer there are, so the blocks take
+    // as long to run as they take to come in, and with two or fewer it takes min_time. This is Marlin's SLOWDOWN except it
+    // also slows the block after a lone running one, or the first after the queue ran dry, as with a steadily slow input
+    // that is all there ever is, and never slows a block to take longer than min_time, which Marlin's 2*(min_time - t)
+    // would with one queued. It does not slow blocks while the queue is filling back up, when more are queued than were
+    // for the previous block
+    static float slowdown_rate(float rate_mm_s, float distance, unsigned int queued, unsigned int previously_queued, unsigned int queue_size, float min_time)
+    {
+        if(min_time <= 0.0F || distance <= 0.0F || queued >= queue_size / 2 || queued > previously_queued) return rate_mm_s;
+        float t= distance / rate_mm_s;
+        if(t >= min_time) return rate_mm_s;
+        return distance / (t + 2.0F * (min_time - t) / (queued > 2 ? queued : 2));
+    }
+
     friend class Robot; // for acceleration, junction deviation, minimum_planner_speed
 
 private:
@@ -33,6 +49,8 @@ private:
     float junction_deviation;    // Setting
     float z_junction_deviation;  // Setting
     float minimum_planner_speed; // Setting
+    float slowdown_time;         // Setting
+    unsigned int slowdown_queued; // blocks queued when the previous block was appended
 };
 
 
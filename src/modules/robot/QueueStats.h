@@ -0,0 +1,71 @@
+#ifndef QUEUESTATS_H
+#define QUEUESTATS_H
+
+#include <stdint.h>
+
+// How well the block queue is being kept fed, as the conveyor sees it. An underrun is the queue running dry, the machine
+// stopping at the end of the last block, and more blocks then coming within underrun_window. Waiting for the queue to
+// empty on purpose (M400, G4, homing ...) is not one, nor is the gap before the next job.
+// The min depth is the fewest blocks left queued after appending one since the queue was last full, so it only shows once
+// a job has got going and the queue has filled
+class QueueStats
+{
+public:
+    static const uint32_t underrun_window_us= 1000000;
+
+    QueueStats() { reset(); }
+
+    void reset()
+    {
+        min_depth= 0xFFFFFFFFUL;
+        underruns= 0;
+        underrun_us= 0;
+        longest_underrun_us= 0;
+        dry= false;
+        primed= false;
+    }
+
+    // a block was appended leaving depth blocks queued
+    void appended(uint32_t depth, bool full)
+    {
+        if(full) primed= true;
+        else if(primed && depth < min_depth) min_depth= depth;
+    }
+
+    // the last block queued has finished, expected if something was waiting for the queue to empty
+    void ran_dry(uint32_t now_us, bool expected)
+    {
+        primed= false;
+        dry= !expected;
+        dry_at= now_us;
+    }
+
+    // the queue started running again
+    void restarted(uint32_t now_us)
+    {
+        if(!dry) return;
+        dry= false;
+        uint32_t gap= now_us - dry_at;
+        if(gap >= underrun_window_us) return;
+        underruns++;
+        underrun_us += gap;
+        if(gap > longest_underrun_us) longest_underrun_us= gap;
+    }
+
+    bool has_min_depth() const { return min_depth != 0xFFFFFFFFUL; }
+    uint32_t get_min_depth() const { return min_depth; }
+    uint32_t get_underruns() const { return underruns; }
+    uint32_t get_underrun_us() const { return underrun_us; }
+    uint32_t get_longest_underrun_us() const { return longest_underrun_us; }
+
+private:
+    uint32_t min_depth;
+    uint32_t underruns;
+    uint32_t underrun_us;
+    uint32_t longest_underrun_us;
+    uint32_t dry_at;
+    volatile bool dry;
+    bool primed;
+};
+
+#endif
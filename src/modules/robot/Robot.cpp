@@ -39,6 +39,10 @@ using std::string;
 #include "StreamOutputPool.h"
 #include "ExtruderPublicAccess.h"
 #include "GcodeDispatch.h"
+#include "Stepper.h"
+#include "CubicBezier.h"
+#include "BedMesh.h"
+#include "arc_segments.h"
 
 
 #define  default_seek_rate_checksum          CHECKSUM("default_seek_rate")
@@ -46,11 +50,19 @@ using std::string;
 #define  mm_per_line_segment_checksum        CHECKSUM("mm_per_line_segment")
 #define  delta_segments_per_second_checksum  CHECKSUM("delta_segments_per_second")
 #define  mm_per_arc_segment_checksum         CHECKSUM("mm_per_arc_segment")
+#define  mm_max_arc_error_checksum           CHECKSUM("mm_max_arc_error")
+#define  mm_max_kinematic_error_checksum     CHECKSUM("mm_max_kinematic_error")
+#define  mm_max_mesh_error_checksum          CHECKSUM("mm_max_mesh_error")
+#define  xy_skew_factor_checksum             CHECKSUM("xy_skew_factor")
+#define  xz_skew_factor_checksum             CHECKSUM("xz_skew_factor")
+#define  yz_skew_factor_checksum             CHECKSUM("yz_skew_factor")
 #define  arc_correction_checksum             CHECKSUM("arc_correction")
 #define  x_axis_max_speed_checksum           CHECKSUM("x_axis_max_speed")
 #define  y_axis_max_speed_checksum           CHECKSUM("y_axis_max_speed")
 #define  z_axis_max_speed_checksum           CHECKSUM("z_axis_max_speed")
 #define  segment_z_moves_checksum            CHECKSUM("segment_z_moves")
+#define  jog_queue_blocks_checksum           CHECKSUM("jog_queue_blocks")
+#define  jog_segment_time_checksum           CHECKSUM("jog_segment_time")
 
 // arm solutions
 #define  arm_solution_checksum               CHECKSUM("arm_solution")
@@ -89,6 +101,7 @@ using std::string;
 #define MOTION_MODE_CW_ARC 2 // G2
 #define MOTION_MODE_CCW_ARC 3 // G3
 #define MOTION_MODE_CANCEL 4 // G80
+#define MOTION_MODE_CUBIC_SPLINE 5 // G5
 
 #define PATH_CONTROL_MODE_EXACT_PATH 0
 #define PATH_CONTROL_MODE_EXACT_STOP 1
@@ -116,18 +129,26 @@ Robot::Robot()
     clear_vector(this->last_machine_position);
     this->arm_solution = NULL;
     seconds_per_minute = 60.0F;
-    this->clearToolOffset();
+    clear_vector(this->skew_factor);
     this->compensationTransform = nullptr;
+    this->compensation_mesh = nullptr;
     this->wcs_offsets.fill(wcs_t(0.0F, 0.0F, 0.0F));
     this->g92_offset = wcs_t(0.0F, 0.0F, 0.0F);
+    this->clearToolOffset();
     this->next_command_is_MCS = false;
     this->disable_segmentation= false;
+    this->jogging= false;
+    this->corner_pending= false;
+    this->path_tolerance= 0;
 }
 
 //Called when the module has just been loaded
 void Robot::on_module_loaded()
 {
     this->register_for_event(ON_GCODE_RECEIVED);
+    this->register_for_event(ON_MAIN_LOOP);
+    this->register_for_event(ON_IDLE);
+    this->register_for_event(ON_HALT);
 
     // Configuration
     this->load_config();
@@ -179,15 +200,29 @@ void Robot::load_config()
     this->seek_rate           = THEKERNEL->config->value(default_seek_rate_checksum   )->by_default(  100.0F)->as_number();
     this->mm_per_line_segment = THEKERNEL->config->value(mm_per_line_segment_checksum )->by_default(    0.0F)->as_number();
     this->delta_segments_per_second = THEKERNEL->config->value(delta_segments_per_second_checksum )->by_default(0.0f   )->as_number();
+    this->mm_max_kinematic_error = THEKERNEL->config->value(mm_max_kinematic_error_checksum )->by_default(0.0f )->as_number();
+    this->mm_max_mesh_error = THEKERNEL->config->value(mm_max_mesh_error_checksum )->by_default(0.0f )->as_number();
     this->mm_per_arc_segment  = THEKERNEL->config->value(mm_per_arc_segment_checksum  )->by_default(    0.5f)->as_number();
+    this->mm_max_arc_error    = THEKERNEL->config->value(mm_max_arc_error_checksum    )->by_default(   0.0f)->as_number(); // off, arcs are cut by mm_per_arc_segment
     this->arc_correction      = THEKERNEL->config->value(arc_correction_checksum      )->by_default(    5   )->as_number();
 
+    // axis skew correction, the tangent of how far the angle between the two axes is out from 90°
+    this->skew_factor[0]      = THEKERNEL->config->value(xy_skew_factor_checksum      )->by_default(  0.0F  )->as_number();
+    this->skew_factor[1]      = THEKERNEL->config->value(xz_skew_factor_checksum      )->by_default(  0.0F  )->as_number();
+    this->skew_factor[2]      = THEKERNEL->config->value(yz_skew_factor_checksum      )->by_default(  0.0F  )->as_number();
+    update_wcs_transform();
+
     this->max_speeds[X_AXIS]  = THEKERNEL->config->value(x_axis_max_speed_checksum    )->by_default(60000.0F)->as_number() / 60.0F;
     this->max_speeds[Y_AXIS]  = THEKERNEL->config->value(y_axis_max_speed_checksum    )->by_default(60000.0F)->as_number() / 60.0F;
     this->max_speeds[Z_AXIS]  = THEKERNEL->config->value(z_axis_max_speed_checksum    )->by_default(  300.0F)->as_number() / 60.0F;
 
     this->segment_z_moves     = THEKERNEL->config->value(segment_z_moves_checksum     )->by_default(true)->as_bool();
 
+    // jogs only keep this many blocks of this many seconds each queued ahead, so a jog cancel does not run on through a long queue
+    this->jog_queue_blocks    = THEKERNEL->config->value(jog_queue_blocks_checksum    )->by_default(    4   )->as_number();
+    this->jog_segment_time    = THEKERNEL->config->value(jog_segment_time_checksum    )->by_default(  0.1F  )->as_number();
+    if(this->jog_queue_blocks < 2) this->jog_queue_blocks= 2;
+
     // Make our 3 StepperMotors
     uint16_t const checksums[][5] = {
         ACTUATOR_CHECKSUMS("alpha"),
@@ -244,6 +279,7 @@ void Robot::pop_state()
         this->absolute_mode = std::get<2>(s);
         this->inch_mode = std::get<3>(s);
         this->current_wcs = std::get<4>(s);
+        update_wcs_transform();
     }
 }
 
@@ -308,11 +344,20 @@ int Robot::print_position(uint8_t subcode, char *buf, size_t bufsize) const
 // converts current last milestone (machine position without compensation transform) to work coordinate system (inverse transform)
 Robot::wcs_t Robot::mcs2wcs(const Robot::wcs_t& pos) const
 {
-    return std::make_tuple(
-        std::get<X_AXIS>(pos) - std::get<X_AXIS>(wcs_offsets[current_wcs]) + std::get<X_AXIS>(g92_offset) - std::get<X_AXIS>(tool_offset),
-        std::get<Y_AXIS>(pos) - std::get<Y_AXIS>(wcs_offsets[current_wcs]) + std::get<Y_AXIS>(g92_offset) - std::get<Y_AXIS>(tool_offset),
-        std::get<Z_AXIS>(pos) - std::get<Z_AXIS>(wcs_offsets[current_wcs]) + std::get<Z_AXIS>(g92_offset) - std::get<Z_AXIS>(tool_offset)
-    );
+    float p[3]{std::get<X_AXIS>(pos), std::get<Y_AXIS>(pos), std::get<Z_AXIS>(pos)};
+    mcs2wcs_transform.apply(p, p);
+    return wcs_t(p[X_AXIS], p[Y_AXIS], p[Z_AXIS]);
+}
+
+// rebuild the work to machine transform, must be called whenever any of the offsets or the skew change.
+// The skew applies to positions in the WCS, the offsets are machine positions so are added after it
+void Robot::update_wcs_transform()
+{
+    wcs2mcs_transform = AffineTransform::skew(skew_factor[0], skew_factor[1], skew_factor[2]).then(AffineTransform::translation(
+        std::get<X_AXIS>(wcs_offsets[current_wcs]) - std::get<X_AXIS>(g92_offset) + std::get<X_AXIS>(tool_offset),
+        std::get<Y_AXIS>(wcs_offsets[current_wcs]) - std::get<Y_AXIS>(g92_offset) + std::get<Y_AXIS>(tool_offset),
+        std::get<Z_AXIS>(wcs_offsets[current_wcs]) - std::get<Z_AXIS>(g92_offset) + std::get<Z_AXIS>(tool_offset)));
+    mcs2wcs_transform = wcs2mcs_transform.inverse();
 }
 
 // this does a sanity check that actuator speeds do not exceed steps rate capability
@@ -336,12 +381,18 @@ void Robot::on_gcode_received(void *argument)
 
     this->motion_mode = -1;
 
+    // anything but another line we can blend into has to wait for the end of the last blended line to be queued
+    if(this->corner_pending && !(gcode->has_g && (gcode->g == 0 || gcode->g == 1) && is_blendable(gcode))) {
+        flush_corner();
+    }
+
     if( gcode->has_g) {
         switch( gcode->g ) {
             case 0:  this->motion_mode = MOTION_MODE_SEEK;    break;
             case 1:  this->motion_mode = MOTION_MODE_LINEAR;  break;
             case 2:  this->motion_mode = MOTION_MODE_CW_ARC;  break;
             case 3:  this->motion_mode = MOTION_MODE_CCW_ARC; break;
+            case 5:  this->motion_mode = MOTION_MODE_CUBIC_SPLINE; break;
             case 4: { // G4 pause
                 uint32_t delay_ms = 0;
                 if (gcode->has_letter('P')) {
@@ -394,6 +445,7 @@ void Robot::on_gcode_received(void *argument)
                             if(gcode->has_letter('Z')) z = to_millimeters(gcode->get_value('Z'));
                         }
                         wcs_offsets[n] = wcs_t(x, y, z);
+                        update_wcs_transform();
                     }
                 }
                 break;
@@ -404,6 +456,9 @@ void Robot::on_gcode_received(void *argument)
             case 20: this->inch_mode = true;   break;
             case 21: this->inch_mode = false;   break;
 
+            case 61: this->path_tolerance = 0; break; // exact path
+            case 64: this->path_tolerance = gcode->has_letter('P') ? this->to_millimeters(gcode->get_value('P')) : 0; break; // blend corners within P
+
             case 54: case 55: case 56: case 57: case 58: case 59:
                 // select WCS 0-8: G54..G59, G59.1, G59.2, G59.3
                 current_wcs = gcode->g - 54;
@@ -411,6 +466,7 @@ void Robot::on_gcode_received(void *argument)
                     current_wcs += gcode->subcode;
                     if(current_wcs >= MAX_WCS) current_wcs = MAX_WCS - 1;
                 }
+                update_wcs_transform();
                 break;
 
             case 90: this->absolute_mode = true;   break;
@@ -449,6 +505,7 @@ void Robot::on_gcode_received(void *argument)
                     g92_offset = wcs_t(x, y, z);
                 }
 
+                update_wcs_transform();
                 return;
             }
         }
@@ -456,7 +513,11 @@ void Robot::on_gcode_received(void *argument)
     } else if( gcode->has_m) {
         switch( gcode->m ) {
             case 0: // M0 feed hold
-                if(THEKERNEL->is_grbl_mode()) THEKERNEL->set_feed_hold(true);
+                if(THEKERNEL->is_grbl_mode()) {
+                    // the moves before it finish first, the hold would otherwise stop them wherever they had got to
+                    THEKERNEL->conveyor->wait_for_empty_queue();
+                    THEKERNEL->set_feed_hold(true);
+                }
                 break;
 
             case 30: // M30 end of program in grbl mode (otherwise it is delete sdcard file)
@@ -465,6 +526,7 @@ void Robot::on_gcode_received(void *argument)
             case 2: // M2 end of program
                 current_wcs = 0;
                 absolute_mode = true;
+                update_wcs_transform();
                 break;
 
             case 92: // M92 - set steps per mm
@@ -624,9 +686,23 @@ void Robot::on_gcode_received(void *argument)
                     std::tie(x, y, z) = g92_offset;
                     gcode->stream->printf("G92.3 X%f Y%f Z%f\n", x, y, z); // sets G92 to the specified values
                 }
+
+                if(skew_factor[0] != 0.0F || skew_factor[1] != 0.0F || skew_factor[2] != 0.0F) {
+                    gcode->stream->printf(";Axis skew factors XY XZ YZ:\nM852 I%1.6f J%1.6f K%1.6f\n", skew_factor[0], skew_factor[1], skew_factor[2]);
+                }
             }
             break;
 
+            case 852: // M852 Ixy Jxz Kyz set axis skew correction factors
+                if(gcode->has_letter('I')) skew_factor[0] = gcode->get_value('I');
+                if(gcode->has_letter('J')) skew_factor[1] = gcode->get_value('J');
+                if(gcode->has_letter('K')) skew_factor[2] = gcode->get_value('K');
+                if(gcode->get_num_args() == 0) {
+                    gcode->stream->printf("XY: %1.6f XZ: %1.6f YZ: %1.6f\n", skew_factor[0], skew_factor[1], skew_factor[2]);
+                }
+                update_wcs_transform();
+                break;
+
             case 665: { // M665 set optional arm solution variables based on arm solution.
                 // the parameter args could be any letter each arm solution only accepts certain ones
                 BaseSolution::arm_options_t options = gcode->get_args();
@@ -668,10 +744,10 @@ void Robot::on_gcode_received(void *argument)
     next_command_is_MCS = false; // must be on same line as G0 or G1
 }
 
-// process a G0/G1/G2/G3
-void Robot::process_move(Gcode *gcode)
+// extract the XYZ parameters from a move and apply offsets to get the machine coordinate target
+// (less compensation transform which needs to be done after segmentation)
+void Robot::get_move_target(Gcode *gcode, float target[3]) const
 {
-    // we have a G0/G1/G2/G3 so extract parameters and apply offsets to get machine coordinate target
     float param[3]{NAN, NAN, NAN};
     for(int i= X_AXIS; i <= Z_AXIS; ++i) {
         char letter= 'X'+i;
@@ -680,34 +756,23 @@ void Robot::process_move(Gcode *gcode)
         }
     }
 
-    float offset[3]{0,0,0};
-    for(char letter = 'I'; letter <= 'K'; letter++) {
-        if( gcode->has_letter(letter) ) {
-            offset[letter - 'I'] = this->to_millimeters(gcode->get_value(letter));
-        }
-    }
-
-    // calculate target in machine coordinates (less compensation transform which needs to be done after segmentation)
-    float target[3]{last_milestone[X_AXIS], last_milestone[Y_AXIS], last_milestone[Z_AXIS]};
+    memcpy(target, last_milestone, sizeof(last_milestone));
     if(!next_command_is_MCS) {
         if(this->absolute_mode) {
-            // apply wcs offsets and g92 offset and tool offset
-            if(!isnan(param[X_AXIS])) {
-                target[X_AXIS]= param[X_AXIS] + std::get<X_AXIS>(wcs_offsets[current_wcs]) - std::get<X_AXIS>(g92_offset) + std::get<X_AXIS>(tool_offset);
-            }
-
-            if(!isnan(param[Y_AXIS])) {
-                target[Y_AXIS]= param[Y_AXIS] + std::get<Y_AXIS>(wcs_offsets[current_wcs]) - std::get<Y_AXIS>(g92_offset) + std::get<Y_AXIS>(tool_offset);
-            }
-
-            if(!isnan(param[Z_AXIS])) {
-                target[Z_AXIS]= param[Z_AXIS] + std::get<Z_AXIS>(wcs_offsets[current_wcs]) - std::get<Z_AXIS>(g92_offset) + std::get<Z_AXIS>(tool_offset);
-            }
+            // apply wcs offsets, g92 offset, tool offset and skew in one go
+            float from[3];
+            mcs2wcs_transform.apply(last_milestone, from);
+            wcs2mcs_transform.move_target(param, from, last_milestone, target);
 
         }else{
-            // they are deltas from the last_milestone if specified
+            // they are deltas from the last_milestone if specified, skewed but not offset
+            float delta[3];
             for(int i= X_AXIS; i <= Z_AXIS; ++i) {
-                if(!isnan(param[i])) target[i] = param[i] + last_milestone[i];
+                delta[i] = isnan(param[i]) ? 0.0F : param[i];
+            }
+            wcs2mcs_transform.apply_linear(delta, delta);
+            for(int i= X_AXIS; i <= Z_AXIS; ++i) {
+                target[i] = last_milestone[i] + delta[i];
             }
         }
 
@@ -717,6 +782,21 @@ void Robot::process_move(Gcode *gcode)
             if(!isnan(param[i])) target[i] = param[i];
         }
     }
+}
+
+// process a G0/G1/G2/G3
+void Robot::process_move(Gcode *gcode)
+{
+    // we have a G0/G1/G2/G3 so extract parameters and apply offsets to get machine coordinate target
+    float target[3];
+    get_move_target(gcode, target);
+
+    float offset[3]{0,0,0};
+    for(char letter = 'I'; letter <= 'K'; letter++) {
+        if( gcode->has_letter(letter) ) {
+            offset[letter - 'I'] = this->to_millimeters(gcode->get_value(letter));
+        }
+    }
 
     if( gcode->has_letter('F') ) {
         if( this->motion_mode == MOTION_MODE_SEEK )
@@ -731,15 +811,20 @@ void Robot::process_move(Gcode *gcode)
         case MOTION_MODE_CANCEL:
             break;
         case MOTION_MODE_SEEK:
-            moved= this->append_line(gcode, target, this->seek_rate / seconds_per_minute );
+            if(is_blendable(gcode)) moved= this->append_blended_line(gcode, target, this->seek_rate / seconds_per_minute );
+            else moved= this->append_line(gcode, target, this->seek_rate / seconds_per_minute );
             break;
         case MOTION_MODE_LINEAR:
-            moved= this->append_line(gcode, target, this->feed_rate / seconds_per_minute );
+            if(is_blendable(gcode)) moved= this->append_blended_line(gcode, target, this->feed_rate / seconds_per_minute );
+            else moved= this->append_line(gcode, target, this->feed_rate / seconds_per_minute );
             break;
         case MOTION_MODE_CW_ARC:
         case MOTION_MODE_CCW_ARC:
             moved= this->compute_arc(gcode, offset, target );
             break;
+        case MOTION_MODE_CUBIC_SPLINE:
+            moved= this->append_spline(gcode, target );
+            break;
     }
 
     if(moved) {
@@ -748,6 +833,134 @@ void Robot::process_move(Gcode *gcode)
     }
 }
 
+// something is waiting for the queue to empty, nothing will come to blend into the last line until it has, so queue its end
+void Robot::on_idle(void *argument)
+{
+    if(this->corner_pending && THEKERNEL->conveyor->is_waiting() && !THEKERNEL->conveyor->is_flushing()) {
+        flush_corner();
+    }
+}
+
+void Robot::on_halt(void *argument)
+{
+    // the queue gets flushed, so forget the rest of the last line
+    if(argument == nullptr) this->corner_pending= false;
+}
+
+void Robot::on_main_loop(void *argument)
+{
+    // nothing else has arrived and the queue is down to the block executing and the last one queued, which is planned to
+    // stop where the end of the last blended line was held back. Queue that end before the last block begins, or the
+    // machine would stop there and then again at the end of the line. The next line is not blended into it
+    if(this->corner_pending && THEKERNEL->conveyor->queued_blocks() <= 2) {
+        flush_corner();
+    }
+
+    if(THEKERNEL->get_jog_cancel()) {
+        cancel_jog();
+
+    }else if(jogging && THEKERNEL->conveyor->is_queue_empty()) {
+        jogging= false;
+    }
+}
+
+// grbl style jog ($J=), takes X Y Z and a mandatory F in mm/min, plus optionally G20/G21, G90/G91 or G53 which only apply to the jog.
+// The move is cut into short segments and only a few are queued at a time, so the jog can be cancelled with a controlled
+// deceleration by the jog cancel realtime command (0x85) without carrying on through a long queue.
+// Blocks until the last segment is queued, returns false and sets the error in the gcode if the jog could not be done.
+bool Robot::jog(Gcode *gcode)
+{
+    if(THEKERNEL->is_halted()) {
+        gcode->is_error= true;
+        gcode->txt_after_ok= "Alarm lock";
+        return false;
+    }
+
+    if(!gcode->has_letter('F')) {
+        gcode->is_error= true;
+        gcode->txt_after_ok= "Undefined feed rate";
+        return false;
+    }
+
+    flush_corner();
+
+    // modal settings on the jog line only apply to this jog
+    bool im= this->inch_mode, am= this->absolute_mode, mcs= this->next_command_is_MCS;
+    if(gcode->has_g) {
+        switch(gcode->g) {
+            case 20: this->inch_mode = true; break;
+            case 21: this->inch_mode = false; break;
+            case 53: this->next_command_is_MCS = true; break;
+            case 90: this->absolute_mode = true; break;
+            case 91: this->absolute_mode = false; break;
+        }
+    }
+
+    float target[3];
+    get_move_target(gcode, target);
+    float rate_mm_s= this->to_millimeters(gcode->get_value('F')) / 60.0F;
+
+    this->inch_mode= im;
+    this->absolute_mode= am;
+    this->next_command_is_MCS= mcs;
+
+    float millimeters_of_travel= sqrtf(powf( target[X_AXIS] - last_milestone[X_AXIS], 2 ) +  powf( target[Y_AXIS] - last_milestone[Y_AXIS], 2 ) +  powf( target[Z_AXIS] - last_milestone[Z_AXIS], 2 ));
+    if(millimeters_of_travel < 0.00001F) return true;
+
+    // each segment takes jog_segment_time at the requested rate, or less if the line would otherwise get segmented more finely
+    float seconds= this->jog_segment_time;
+    if(this->delta_segments_per_second > 1.0F) seconds= min(seconds, 1.0F / this->delta_segments_per_second);
+    float segment_length= rate_mm_s * seconds;
+    if(this->mm_per_line_segment > 0.0F) segment_length= min(segment_length, this->mm_per_line_segment);
+    uint16_t segments= max(1.0F, ceilf(millimeters_of_travel / segment_length));
+
+    float start[3];
+    memcpy(start, last_milestone, sizeof(start));
+    for (int i = 1; i <= segments; i++) {
+        // keep a short horizon queued, waiting here also gives us a chance to see a cancel
+        while(THEKERNEL->conveyor->queued_blocks() >= jog_queue_blocks && !THEKERNEL->get_jog_cancel() && !THEKERNEL->is_halted()) {
+            THEKERNEL->conveyor->ensure_running();
+            THEKERNEL->call_event(ON_IDLE, this);
+        }
+
+        if(THEKERNEL->get_jog_cancel()) {
+            cancel_jog();
+            return true;
+        }
+        if(THEKERNEL->is_halted()) return true;
+
+        float segment_end[3];
+        for(int a = X_AXIS; a <= Z_AXIS; a++) {
+            segment_end[a]= (i == segments) ? target[a] : start[a] + (target[a] - start[a]) * i / segments;
+        }
+
+        if(!this->append_milestone(gcode, segment_end, rate_mm_s)) return false;
+        memcpy(this->last_milestone, segment_end, sizeof(this->last_milestone));
+        this->jogging= true;
+    }
+
+    return true;
+}
+
+// jog cancel realtime command received, stop and discard any jog in progress
+// MUST be called from main loop context (or something called from it that is waiting for the queue) as it flushes the queue
+void Robot::cancel_jog()
+{
+    THEKERNEL->set_jog_cancel(false);
+    if(!this->jogging) return;
+    this->jogging= false;
+
+    // decelerate to a stop the same way a feed hold does, then throw away what is left in the queue
+    THEKERNEL->stepper->decelerate_to_stop();
+    while(THEKERNEL->stepper->is_stopping()) {
+        THEKERNEL->call_event(ON_IDLE, this);
+    }
+    THEKERNEL->conveyor->flush_queue();
+
+    // we stopped somewhere short of where the queue was going so find out where we are
+    reset_position_from_current_actuator_position();
+}
+
 // We received a new gcode, and one of the functions
 // determined the distance for that given gcode. So now we can attach this gcode to the right block
 // and continue
@@ -763,6 +976,8 @@ void Robot::distance_in_gcode_is_known(Gcode * gcode)
 // so in those cases the final position is compensated.
 void Robot::reset_axis_position(float x, float y, float z)
 {
+    this->corner_pending= false;
+
     // these are set to the same as compensation was not used to get to the current position
     last_machine_position[X_AXIS]= last_milestone[X_AXIS] = x;
     last_machine_position[Y_AXIS]= last_milestone[Y_AXIS] = y;
@@ -796,6 +1011,8 @@ void Robot::reset_actuator_position(const ActuatorCoordinates &ac)
 // Use FK to find out where actuator is and reset to match
 void Robot::reset_position_from_current_actuator_position()
 {
+    this->corner_pending= false;
+
     ActuatorCoordinates actuator_pos;
     for (size_t i = 0; i < actuators.size(); i++) {
         // NOTE actuator::current_position is curently NOT the same as actuator::last_milestone after an abrupt abort
@@ -818,7 +1035,8 @@ void Robot::reset_position_from_current_actuator_position()
 // Convert target (in machine coordinates) from millimeters to steps, and append this to the planner
 // target is in machine coordinates without the compensation transform, however we save a last_machine_position that includes
 // all transforms and is what we actually convert to actuator positions
-bool Robot::append_milestone(Gcode * gcode, const float target[], float rate_mm_s)
+// actuator_target may be passed if the arm solution has already converted target, only when there is no compensationTransform
+bool Robot::append_milestone(Gcode * gcode, const float target[], float rate_mm_s, float curve_radius, const ActuatorCoordinates *actuator_target)
 {
     float deltas[3];
     float unit_vec[3];
@@ -872,7 +1090,11 @@ bool Robot::append_milestone(Gcode * gcode, const float target[], float rate_mm_
     }
 
     // find actuator position given the machine position, use actual adjusted target
-    arm_solution->cartesian_to_actuator( this->last_machine_position, actuator_pos );
+    if(actuator_target != nullptr) {
+        actuator_pos = *actuator_target;
+    } else {
+        arm_solution->cartesian_to_actuator( this->last_machine_position, actuator_pos );
+    }
 
     float isecs = rate_mm_s / millimeters_of_travel;
     // check per-actuator speed limits
@@ -885,7 +1107,7 @@ bool Robot::append_milestone(Gcode * gcode, const float target[], float rate_mm_
     }
 
     // Append the block to the planner
-    THEKERNEL->planner->append_block( actuator_pos, rate_mm_s, millimeters_of_travel, unit_vec );
+    THEKERNEL->planner->append_block( actuator_pos, rate_mm_s, millimeters_of_travel, unit_vec, curve_radius );
 
     return true;
 }
@@ -919,12 +1141,48 @@ bool Robot::append_line(Gcode *gcode, const float target[], float rate_mm_s )
         }
     }
 
-    // We cut the line into smaller segments. This is only needed on a cartesian robot for zgrid, but always necessary for robots with rotational axes like Deltas.
-    // In delta robots either mm_per_line_segment can be used OR delta_segments_per_second
-    // The latter is more efficient and avoids splitting fast long lines into very small segments, like initial z move to 0, it is what Johanns Marlin delta port does
+    bool moved;
+    if(!segment_z_moves && !gcode->has_letter('X') && !gcode->has_letter('Y')) {
+        moved= this->append_milestone(gcode, target, rate_mm_s);
+    } else {
+        moved= this->append_segments(gcode, this->last_milestone, target, rate_mm_s);
+        if(THEKERNEL->is_halted()) return false;
+    }
+
+    this->next_command_is_MCS = false; // always reset this
+
+    if(moved) {
+        // if adding these blocks didn't start executing, do that now
+        THEKERNEL->conveyor->ensure_running();
+    }
+
+    return moved;
+}
+
+
+// Queue a straight move from start to target, cutting it into smaller segments where needed. This is only needed on a
+// cartesian robot for zgrid, but always necessary for robots with rotational axes like Deltas. Lines come through here,
+// and so do the chords of arcs and curves, which can be long when they are sized by mm_max_arc_error.
+// In delta robots either mm_per_line_segment can be used OR delta_segments_per_second
+// The latter is more efficient and avoids splitting fast long lines into very small segments, like initial z move to 0, it is what Johanns Marlin delta port does
+// If mm_max_kinematic_error is set it overrides both and only splits as much as the arm solution actually needs
+// On a cartesian with a bed mesh active mm_max_mesh_error can be set instead of mm_per_line_segment to only split where the mesh needs it
+// curve_radius is passed to the planner for the first segment, the rest carry straight on from it
+bool Robot::append_segments(Gcode *gcode, const float start[], const float target[], float rate_mm_s, float curve_radius)
+{
+    float length = sqrtf(powf( target[X_AXIS] - start[X_AXIS], 2 ) +  powf( target[Y_AXIS] - start[Y_AXIS], 2 ) +  powf( target[Z_AXIS] - start[Z_AXIS], 2 ));
+    if(length < 0.00001F) return false;
+
     uint16_t segments;
+    bool moved= false;
+
+    if(this->disable_segmentation) {
+        segments= 1;
 
-    if(this->disable_segmentation || (!segment_z_moves && !gcode->has_letter('X') && !gcode->has_letter('Y'))) {
+    } else if(this->mm_max_kinematic_error > 0.0F) {
+        // the segments are not all the same length so they get queued here, all but the last one
+        moved= append_kinematic_segments(gcode, start, target, length, rate_mm_s, curve_radius);
+        if(THEKERNEL->is_halted()) return false;
         segments= 1;
 
     } else if(this->delta_segments_per_second > 1.0F) {
@@ -932,54 +1190,214 @@ bool Robot::append_line(Gcode *gcode, const float target[], float rate_mm_s )
         // segment based on current speed and requested segments per second
         // the faster the travel speed the fewer segments needed
         // NOTE rate is mm/sec and we take into account any speed override
-        float seconds = gcode->millimeters_of_travel / rate_mm_s;
+        float seconds = length / rate_mm_s;
         segments = max(1.0F, ceilf(this->delta_segments_per_second * seconds));
         // TODO if we are only moving in Z on a delta we don't really need to segment at all
 
+    } else if(this->mm_max_mesh_error > 0.0F && compensationTransform && this->compensation_mesh != nullptr) {
+        // queues all but the last segment
+        moved= append_mesh_segments(gcode, start, target, length, rate_mm_s, curve_radius);
+        if(THEKERNEL->is_halted()) return false;
+        segments= 1;
+
     } else {
         if(this->mm_per_line_segment == 0.0F) {
             segments = 1; // don't split it up
         } else {
-            segments = ceilf( gcode->millimeters_of_travel / this->mm_per_line_segment);
+            segments = ceilf( length / this->mm_per_line_segment);
         }
     }
 
-    bool moved= false;
+    if(moved) curve_radius= 0.0F;
+
     if (segments > 1) {
         // A vector to keep track of the endpoint of each segment
         float segment_delta[3];
-        float segment_end[3]{last_milestone[X_AXIS], last_milestone[Y_AXIS], last_milestone[Z_AXIS]};
+        float segment_end[3];
+        // the arm solution converts the segment ends a batch at a time, unless compensation is going to move them off the line
+        const int batch_size = 8;
+        ActuatorCoordinates batch[batch_size];
 
         // How far do we move each segment?
         for (int i = X_AXIS; i <= Z_AXIS; i++)
-            segment_delta[i] = (target[i] - last_milestone[i]) / segments;
+            segment_delta[i] = (target[i] - start[i]) / segments;
 
         // segment 0 is already done - it's the end point of the previous move so we start at segment 1
         // We always add another point after this loop so we stop at segments-1, ie i < segments
         for (int i = 1; i < segments; i++) {
             if(THEKERNEL->is_halted()) return false; // don't queue any more segments
             for(int axis = X_AXIS; axis <= Z_AXIS; axis++ )
-                segment_end[axis] += segment_delta[axis];
+                segment_end[axis] = start[axis] + segment_delta[axis] * i;
+
+            const ActuatorCoordinates *actuator_target= nullptr;
+            if(!compensationTransform) {
+                int n= (i - 1) % batch_size;
+                if(n == 0) arm_solution->cartesian_line_to_actuator(segment_end, segment_delta, min(batch_size, segments - i), batch);
+                actuator_target= &batch[n];
+            }
 
             // Append the end of this segment to the queue
-            bool b= this->append_milestone(gcode, segment_end, rate_mm_s);
-            moved= moved || b;
+            if(this->append_milestone(gcode, segment_end, rate_mm_s, curve_radius, actuator_target)) {
+                moved= true;
+                curve_radius= 0.0F;
+            }
         }
     }
 
     // Append the end of this full move to the queue
-    if(this->append_milestone(gcode, target, rate_mm_s)) moved= true;
+    if(this->append_milestone(gcode, target, rate_mm_s, curve_radius)) moved= true;
 
-    this->next_command_is_MCS = false; // always reset this
+    return moved;
+}
 
-    if(moved) {
-        // if adding these blocks didn't start executing, do that now
-        THEKERNEL->conveyor->ensure_running();
+// Queue all but the last segment of a line split so that the path the arm really takes between the ends of each segment
+// is no further than mm_max_kinematic_error from the line. Each segment is sized by the arm solution from its measured deviation,
+// and the next one is tried a bit longer than the last.
+// Segments are also kept no longer than mm_per_line_segment if that is set, eg for zgrid on a cartesian.
+bool Robot::append_kinematic_segments(Gcode *gcode, const float start[], const float target[], float length, float rate_mm_s, float curve_radius)
+{
+    float unit_vec[3];
+    for (int i = X_AXIS; i <= Z_AXIS; i++)
+        unit_vec[i] = (target[i] - start[i]) / length;
+
+    float segment_start[3]{start[X_AXIS], start[Y_AXIS], start[Z_AXIS]};
+    float segment_end[3];
+    ActuatorCoordinates start_actuator, end_actuator;
+    arm_solution->cartesian_to_actuator(segment_start, start_actuator);
+
+    float max_length = (this->mm_per_line_segment > 0.0F) ? this->mm_per_line_segment : length;
+    float segment_length = max_length;
+    float done = 0;
+    bool moved = false;
+
+    while(true) {
+        if(THEKERNEL->is_halted()) return false; // don't queue any more segments
+
+        float l = arm_solution->segment_length(segment_start, start_actuator, unit_vec, min(segment_length, length - done),
+                                               this->mm_max_kinematic_error, segment_end, end_actuator);
+        done += l;
+        if(length - done < 0.0001F) break; // the caller appends the end of the line
+
+        // the arm solution already converted the end, unless compensation is going to move it
+        if(this->append_milestone(gcode, segment_end, rate_mm_s, curve_radius, compensationTransform ? nullptr : &end_actuator)) {
+            moved = true;
+            curve_radius = 0.0F;
+        }
+        memcpy(segment_start, segment_end, sizeof(segment_start));
+        start_actuator = end_actuator;
+        segment_length = min(l * 1.5F, max_length);
+    }
+
+    return moved;
+}
+
+// Queue all but the last segment of a line split to follow the bed mesh. The compensated surface has a kink at every grid line
+// so a segment ends wherever the line crosses one, and within a cell the line is only split as much as needed to keep
+// it within mm_max_mesh_error of the surface. Long moves over a flat part of the bed are not chopped up for nothing
+// the way mm_per_line_segment does. Only suitable for cartesians, the segments are straight lines in XYZ.
+bool Robot::append_mesh_segments(Gcode *gcode, const float start[], const float target[], float length, float rate_mm_s, float curve_radius)
+{
+    float segment_end[3];
+    float t = 0;
+    bool moved = false;
+
+    while(true) {
+        if(THEKERNEL->is_halted()) return false; // don't queue any more segments
+
+        t = compensation_mesh->next_split(start, target, t, this->mm_max_mesh_error);
+        if((1.0F - t) * length < 0.0001F) break; // the caller appends the end of the line
+
+        for (int i = X_AXIS; i <= Z_AXIS; i++)
+            segment_end[i] = start[i] + (target[i] - start[i]) * t;
+        if(this->append_milestone(gcode, segment_end, rate_mm_s, curve_radius)) {
+            moved = true;
+            curve_radius = 0.0F;
+        }
     }
 
     return moved;
 }
 
+// G64 Pnnn, lines are joined by parabolic blends that pass within path_tolerance of the corner instead of going through it,
+// so the corner does not need to slow down as much as junction_deviation would make it. Only unsegmented XYZ lines are blended.
+bool Robot::is_blendable(Gcode *gcode) const
+{
+    return this->path_tolerance > 0.0F && !this->disable_segmentation && !gcode->has_letter('E') &&
+           this->mm_per_line_segment == 0.0F && this->delta_segments_per_second <= 1.0F && this->mm_max_kinematic_error <= 0.0F &&
+           this->mm_max_mesh_error <= 0.0F;
+}
+
+// Append a line that may be blended into the previous and next ones. To be able to blend into the next move the end
+// of each line is held back until that arrives, or the queue runs short, or something else needs queuing (see flush_corner())
+bool Robot::append_blended_line(Gcode *gcode, const float target[], float rate_mm_s)
+{
+    Vector3 corner(this->last_milestone[X_AXIS], this->last_milestone[Y_AXIS], this->last_milestone[Z_AXIS]);
+    Vector3 delta= Vector3(target[X_AXIS], target[Y_AXIS], target[Z_AXIS]).sub(corner);
+    gcode->millimeters_of_travel = delta.mag();
+    if( gcode->millimeters_of_travel < 0.00001F ) return false;
+
+    if(rate_mm_s <= 0.0F) {
+        // let append_line report it
+        flush_corner();
+        return append_line(gcode, target, rate_mm_s);
+    }
+
+    float len= gcode->millimeters_of_travel;
+    Vector3 u= delta.mul(1.0F / len);
+    float start= 0; // how far along this line the blend from the last one ends
+    float curve_radius= 0;
+
+    if(this->corner_pending) {
+        this->corner_pending= false;
+        Vector3 u_in(this->corner_in_vec[X_AXIS], this->corner_in_vec[Y_AXIS], this->corner_in_vec[Z_AXIS]);
+
+        // 3/4 of the tolerance is for the blend and the rest for flattening it, we can use up to the held back
+        // part of the last line and half of this one
+        float l= CubicBezier::corner_blend_length(u_in, u, this->path_tolerance * 0.75F);
+        l= min(l, min(this->corner_hold, len / 2.0F));
+
+        if(u_in.dot(u) > -0.99F && l > 0.00001F) { // can't blend a reversal
+            Vector3 s= corner.sub(u_in.mul(l));
+            Vector3 e= corner.add(u.mul(l));
+            CubicBezier blend= CubicBezier::corner_blend(s, corner, e);
+            // the rest of the last line up to the blend, then the blend, all tangent continuous
+            this->append_milestone(gcode, s.data(), this->corner_rate, INFINITY);
+            curve_radius= 1.0F / blend.curvature(0);
+            this->append_curve(gcode, blend, e.data(), min(this->corner_rate, rate_mm_s), curve_radius, this->path_tolerance * 0.25F);
+            start= l;
+
+        } else {
+            this->append_milestone(gcode, corner.data(), this->corner_rate, INFINITY);
+        }
+    }
+
+    // the gcode belongs to the straight part of this line
+    this->distance_in_gcode_is_known( gcode );
+
+    // queue this line up to where a blend into the next one could start, no more than half of it, nor further back than
+    // a blend within the tolerance would ever start, which is about 20 times it for a corner of a few degrees
+    float hold= min(len / 2.0F, this->path_tolerance * 20.0F);
+    if(len - hold > start) {
+        Vector3 h= corner.add(u.mul(len - hold));
+        this->append_milestone(gcode, h.data(), rate_mm_s, curve_radius);
+    }
+
+    this->corner_pending= true;
+    memcpy(this->corner_in_vec, u.data(), sizeof(this->corner_in_vec));
+    this->corner_hold= hold;
+    this->corner_rate= rate_mm_s;
+
+    return true;
+}
+
+// queue the held back end of the last blended line (which ends at last_milestone), as whatever comes next is not blended into it
+void Robot::flush_corner()
+{
+    if(!this->corner_pending) return;
+    this->corner_pending= false;
+    // corner_rate is known to be good so the gcode is not needed for reporting errors
+    this->append_milestone(nullptr, this->last_milestone, this->corner_rate, INFINITY);
+}
 
 // Append an arc to the queue ( cutting it into segments as needed )
 bool Robot::append_arc(Gcode * gcode, const float target[], const float offset[], float radius, bool is_clockwise )
@@ -1015,7 +1433,14 @@ bool Robot::append_arc(Gcode * gcode, const float target[], const float offset[]
     this->distance_in_gcode_is_known( gcode );
 
     // Figure out how many segments for this gcode
-    uint16_t segments = floorf(gcode->millimeters_of_travel / this->mm_per_arc_segment);
+    uint16_t segments;
+    if(this->mm_max_arc_error > 0.0F) {
+        // the chords can be long, they get split up like any other line if the arm solution or mesh needs it
+        segments = arc_segments_for_error(angular_travel, radius, this->mm_max_arc_error);
+    } else {
+        segments = floorf(gcode->millimeters_of_travel / this->mm_per_arc_segment);
+    }
+    if(segments < 1) segments= 1;
 
     float theta_per_segment = angular_travel / segments;
     float linear_per_segment = linear_travel / segments;
@@ -1032,22 +1457,17 @@ bool Robot::append_arc(Gcode * gcode, const float target[], const float offset[]
     round off issues for CNC applications.) Single precision error can accumulate to be greater than
     tool precision in some cases. Therefore, arc path correction is implemented.
 
-    Small angle approximation may be used to reduce computation overhead further. This approximation
-    holds for everything, but very small circles and large mm_per_arc_segment values. In other words,
-    theta_per_segment would need to be greater than 0.1 rad and N_ARC_CORRECTION would need to be large
-    to cause an appreciable drift error. N_ARC_CORRECTION~=25 is more than small enough to correct for
-    numerical drift error. N_ARC_CORRECTION may be on the order a hundred(s) before error becomes an
-    issue for CNC machines with the single precision Arduino calculations.
-    This approximation also allows mc_arc to immediately insert a line segment into the planner
-    without the initial overhead of computing cos() or sin(). By the time the arc needs to be applied
-    a correction, the planner should have caught up to the lag caused by the initial mc_arc overhead.
-    This is important when there are successive arc motions.
+    When segmenting by mm_max_arc_error the segments of a small circle can span a large angle, where a small
+    angle approximation of the rotation matrix would be well off, so the matrix is computed exactly once per arc.
+    N_ARC_CORRECTION~=25 is more than small enough to correct for numerical drift error. N_ARC_CORRECTION may be
+    on the order a hundred(s) before error becomes an issue for CNC machines with single precision calculations.
     */
     // Vector rotation matrix values
-    float cos_T = 1 - 0.5F * theta_per_segment * theta_per_segment; // Small angle approximation
-    float sin_T = theta_per_segment;
+    float cos_T = cosf(theta_per_segment);
+    float sin_T = sinf(theta_per_segment);
 
     float arc_target[3];
+    float chord_start[3];
     float sin_Ti;
     float cos_Ti;
     float r_axisi;
@@ -1056,6 +1476,7 @@ bool Robot::append_arc(Gcode * gcode, const float target[], const float offset[]
 
     // Initialize the linear axis
     arc_target[this->plane_axis_2] = this->last_milestone[this->plane_axis_2];
+    memcpy(chord_start, this->last_milestone, sizeof(chord_start));
 
     bool moved= false;
     for (i = 1; i < segments; i++) { // Increment (segments-1)
@@ -1083,12 +1504,13 @@ bool Robot::append_arc(Gcode * gcode, const float target[], const float offset[]
         arc_target[this->plane_axis_2] += linear_per_segment;
 
         // Append this segment to the queue
-        bool b= this->append_milestone(gcode, arc_target, this->feed_rate / seconds_per_minute);
+        bool b= this->append_segments(gcode, chord_start, arc_target, this->feed_rate / seconds_per_minute);
         moved= moved || b;
+        memcpy(chord_start, arc_target, sizeof(chord_start));
     }
 
     // Ensure last segment arrives at target location.
-    if(this->append_milestone(gcode, target, this->feed_rate / seconds_per_minute)) moved= true;
+    if(this->append_segments(gcode, chord_start, target, this->feed_rate / seconds_per_minute)) moved= true;
 
     return moved;
 }
@@ -1110,6 +1532,80 @@ bool Robot::compute_arc(Gcode * gcode, const float offset[], const float target[
     return this->append_arc(gcode, target, offset,  radius, is_clockwise );
 }
 
+// G5 Inn Jnn Pnn Qnn Xnn Ynn, cubic bezier in the XY plane from the current position to X Y, I J is the first control point
+// relative to the start, P Q is the second control point relative to the end. Z moves linearly along the curve if given.
+bool Robot::append_spline(Gcode * gcode, const float target[])
+{
+    if(this->plane_axis_0 != X_AXIS || this->plane_axis_1 != Y_AXIS) {
+        gcode->is_error= true;
+        gcode->txt_after_ok= "G5 only supported in the XY plane";
+        return false;
+    }
+
+    if(!gcode->has_letter('P') || !gcode->has_letter('Q')) {
+        gcode->is_error= true;
+        gcode->txt_after_ok= "G5 requires P and Q";
+        return false;
+    }
+
+    // Z control points a third of the way along each end makes Z linear in t
+    float z0= this->last_milestone[Z_AXIS];
+    float linear_travel= target[Z_AXIS] - z0;
+    Vector3 p0(this->last_milestone[X_AXIS], this->last_milestone[Y_AXIS], z0);
+    Vector3 p3(target[X_AXIS], target[Y_AXIS], target[Z_AXIS]);
+    Vector3 p1= p0.add(Vector3(gcode->has_letter('I') ? this->to_millimeters(gcode->get_value('I')) : 0,
+                               gcode->has_letter('J') ? this->to_millimeters(gcode->get_value('J')) : 0, linear_travel / 3.0F));
+    Vector3 p2= p3.add(Vector3(this->to_millimeters(gcode->get_value('P')), this->to_millimeters(gcode->get_value('Q')), -linear_travel / 3.0F));
+
+    // the curve is never longer than its control polygon, the average of that and the chord is close enough for the extruder and others
+    gcode->millimeters_of_travel = (p1.sub(p0).mag() + p2.sub(p1).mag() + p3.sub(p2).mag() + p3.sub(p0).mag()) / 2.0F;
+
+    if( gcode->millimeters_of_travel < 0.00001F ) {
+        return false;
+    }
+
+    // Mark the gcode as having a known distance
+    this->distance_in_gcode_is_known( gcode );
+
+    // the first junction is an ordinary junction with whatever was before
+    float curve_radius= 0;
+    return append_curve(gcode, CubicBezier(p0, p1, p2, p3), target, this->feed_rate / seconds_per_minute, curve_radius, this->mm_max_arc_error);
+}
+
+// Flatten a curve into lines no more than max_error from it, stepping along it with a step size set by the local
+// curvature, so straight parts get long segments and tight bends short ones.
+// curve_radius is passed to the planner for the first segment, and is returned as the radius of the curve at its end,
+// as the curve is tangent continuous the junctions only turn as much as the curve does at that point
+bool Robot::append_curve(Gcode *gcode, const CubicBezier &curve, const float target[], float rate_mm_s, float &curve_radius, float max_error)
+{
+    // curves have no fixed length fallback, so with mm_max_arc_error off they are flattened to within 0.01mm
+    if(max_error <= 0.0F) max_error= 0.01F;
+
+    bool moved= false;
+    float t= 0;
+    float seg_start[3], seg_target[3];
+    memcpy(seg_start, curve.point(0).data(), sizeof(seg_start));
+    while(t < 1.0F) {
+        if(THEKERNEL->is_halted()) return false; // don't queue any more segments
+
+        t= curve.next_t(t, max_error);
+        if(t < 1.0F) {
+            Vector3 pt= curve.point(t);
+            memcpy(seg_target, pt.data(), sizeof(seg_target));
+        } else {
+            memcpy(seg_target, target, sizeof(seg_target));
+        }
+
+        // the chords can be long where the curve is straight, they get split up like any other line if need be
+        if(this->append_segments(gcode, seg_start, seg_target, rate_mm_s, curve_radius)) moved= true;
+        memcpy(seg_start, seg_target, sizeof(seg_start));
+
+        float k= curve.curvature(t);
+        curve_radius= (k > 0.0F) ? 1.0F / k : INFINITY;
+    }
+
+    return moved;
+}
 
 float Robot::theta(float x, float y)
 {
@@ -1135,11 +1631,13 @@ void Robot::select_plane(uint8_t axis_0, uint8_t axis_1, uint8_t axis_2)
 void Robot::clearToolOffset()
 {
     this->tool_offset= wcs_t(0,0,0);
+    update_wcs_transform();
 }
 
 void Robot::setToolOffset(const float offset[3])
 {
     this->tool_offset= wcs_t(offset[0], offset[1], offset[2]);
+    update_wcs_transform();
 }
 
 float Robot::get_feed_rate() const
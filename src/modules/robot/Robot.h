@@ -16,10 +16,13 @@ using std::string;
 
 #include "libs/Module.h"
 #include "ActuatorCoordinates.h"
+#include "AffineTransform.h"
 
 class Gcode;
 class BaseSolution;
 class StepperMotor;
+class CubicBezier;
+class BedMesh;
 
 // 9 WCS offsets
 #define MAX_WCS 9UL
@@ -30,6 +33,11 @@ class Robot : public Module {
         Robot();
         void on_module_loaded();
         void on_gcode_received(void* argument);
+        void on_main_loop(void* argument);
+        void on_idle(void* argument);
+        void on_halt(void* argument);
+        bool jog(Gcode *gcode);
+        bool is_jogging() const { return jogging; }
 
         void reset_axis_position(float position, int axis);
         void reset_axis_position(float x, float y, float z);
@@ -59,6 +67,8 @@ class Robot : public Module {
 
         // set by a leveling strategy to transform the target of a move according to the current plan
         std::function<void(float[3])> compensationTransform;
+        // set by a grid leveling strategy along with compensationTransform so lines can be split to follow the grid
+        const BedMesh *compensation_mesh;
 
         // Workspace coordinate systems
         wcs_t mcs2wcs(const wcs_t &pos) const;
@@ -70,6 +80,8 @@ class Robot : public Module {
             bool next_command_is_MCS:1;                       // set by G53
             bool disable_segmentation:1;                      // set to disable segmentation
             bool segment_z_moves:1;
+            bool jogging:1;                                   // a $J jog is queued and may be cancelled
+            bool corner_pending:1;                            // the end of the last blended line has not been queued yet
             uint8_t plane_axis_0:2;                           // Current plane ( XY, XZ, YZ )
             uint8_t plane_axis_1:2;
             uint8_t plane_axis_2:2;
@@ -78,21 +90,35 @@ class Robot : public Module {
     private:
         void load_config();
         void distance_in_gcode_is_known(Gcode* gcode);
-        bool append_milestone( Gcode *gcode, const float target[], float rate_mm_s);
+        bool append_milestone( Gcode *gcode, const float target[], float rate_mm_s, float curve_radius= 0.0F, const ActuatorCoordinates *actuator_target= nullptr);
         bool append_line( Gcode* gcode, const float target[], float rate_mm_s);
+        bool append_segments(Gcode* gcode, const float start[], const float target[], float rate_mm_s, float curve_radius= 0.0F);
+        bool append_kinematic_segments(Gcode* gcode, const float start[], const float target[], float length, float rate_mm_s, float curve_radius);
+        bool append_mesh_segments(Gcode* gcode, const float start[], const float target[], float length, float rate_mm_s, float curve_radius);
         bool append_arc( Gcode* gcode, const float target[], const float offset[], float radius, bool is_clockwise );
         bool compute_arc(Gcode* gcode, const float offset[], const float target[]);
+        bool append_spline(Gcode* gcode, const float target[]);
+        bool is_blendable(Gcode *gcode) const;
+        bool append_blended_line(Gcode* gcode, const float target[], float rate_mm_s);
+        void flush_corner();
+        bool append_curve(Gcode* gcode, const CubicBezier &curve, const float target[], float rate_mm_s, float &curve_radius, float max_error);
         void process_move(Gcode *gcode);
+        void get_move_target(Gcode *gcode, float target[3]) const;
+        void cancel_jog();
 
         float theta(float x, float y);
         void select_plane(uint8_t axis_0, uint8_t axis_1, uint8_t axis_2);
         void clearToolOffset();
+        void update_wcs_transform();
 
 
         std::array<wcs_t, MAX_WCS> wcs_offsets; // these are persistent once saved with M500
         uint8_t current_wcs{0}; // 0 means G54 is enabled this is persistent once saved with M500
         wcs_t g92_offset;
         wcs_t tool_offset; // used for multiple extruders, sets the tool offset for the current extruder applied first
+        float skew_factor[3]; // XY, XZ, YZ axis skew correction, persistent once saved with M500
+        AffineTransform wcs2mcs_transform; // all the above composed, rebuilt by update_wcs_transform() when any of them change
+        AffineTransform mcs2wcs_transform;
         std::tuple<float, float, float, uint8_t> last_probe_position{0,0,0,0};
 
         using saved_state_t= std::tuple<float, float, bool, bool, uint8_t>; // save current feedrate and absolute mode, inch mode, current_wcs
@@ -105,8 +131,17 @@ class Robot : public Module {
         float feed_rate;                                     // Current rate for feeding moves ( mm/s )
         float mm_per_line_segment;                           // Setting : Used to split lines into segments
         float mm_per_arc_segment;                            // Setting : Used to split arcs into segments
+        float mm_max_arc_error;                              // Setting : Used to split arcs into segments by the max chord error
         float delta_segments_per_second;                     // Setting : Used to split lines into segments for delta based on speed
+        float mm_max_kinematic_error;                        // Setting : Used to split lines into segments by how far the arm strays from them
+        float mm_max_mesh_error;                             // Setting : Used to split lines into segments by how far they stray from the bed mesh
         float seconds_per_minute;                            // for realtime speed change
+        float jog_segment_time;                              // Setting : seconds per segment when jogging
+        float path_tolerance;                                // G64 P, how far a corner blend may stray from the corner, 0 for exact path
+        float corner_in_vec[3];                              // direction of the last blended line
+        float corner_hold;                                   // length of the end of the last blended line held back
+        float corner_rate;                                   // rate of the last blended line
+        uint8_t jog_queue_blocks;                            // Setting : max blocks queued ahead when jogging
 
         // Number of arc generation iterations by small angle approximation before exact arc trajectory
         // correction. This parameter may be decreased if there are issues with the accuracy of the arc
@@ -20,6 +20,7 @@
 #include "Gcode.h"
 #include "Block.h"
 #include "StepTicker.h"
+#include "StreamOutputPool.h"
 
 #include <vector>
 using namespace std;
@@ -35,8 +36,14 @@ using namespace std;
 Stepper::Stepper()
 {
     this->current_block = NULL;
+    this->staged_block = NULL;
+    this->move_switched = false;
     this->force_speed_update = false;
     this->halted= false;
+    this->hold_state= NOT_HELD;
+    this->hold_speed= 0;
+    this->stop_requested= false;
+    this->num_speed_change_handlers= 0;
 }
 
 //Called when the module has just been loaded
@@ -47,12 +54,14 @@ void Stepper::on_module_loaded()
     this->register_for_event(ON_GCODE_EXECUTE);
     this->register_for_event(ON_GCODE_RECEIVED);
     this->register_for_event(ON_HALT);
+    this->register_for_event(ON_IDLE);
 
     // Get onfiguration
     this->on_config_reload(this);
 
     // Acceleration ticker
     THEKERNEL->step_ticker->register_acceleration_tick_handler([this](){trapezoid_generator_tick(); });
+    THEKERNEL->step_ticker->register_move_switched_handler([this](){on_move_switched(); });
 
     // Attach to the end_of_move stepper event
     for (auto actuator : THEKERNEL->robot->actuators)
@@ -71,11 +80,27 @@ void Stepper::on_halt(void *argument)
     if(argument == nullptr) {
         this->turn_enable_pins_off();
         this->halted= true;
+        // the queue gets flushed, which stops the motors and unpauses the step ticker
+        this->hold_state= NOT_HELD;
+        this->stop_requested= false;
     }else{
         this->halted= false;
     }
 }
 
+// resume from a feed hold once it has been released
+void Stepper::on_idle(void *argument)
+{
+    if(this->hold_state == HELD) {
+        if(!THEKERNEL->get_feed_hold() && !this->stop_requested) resume_from_hold();
+
+    }else if(this->hold_state == HOLD_DECELERATING && this->current_block == NULL && THEKERNEL->conveyor->is_queue_empty()) {
+        // we ran out of blocks before we stopped, so there is nothing to hold
+        this->hold_state= NOT_HELD;
+        this->stop_requested= false;
+    }
+}
+
 void Stepper::on_gcode_received(void *argument)
 {
     Gcode *gcode = static_cast<Gcode *>(argument);
@@ -123,6 +148,14 @@ void Stepper::on_block_begin(void *argument)
 {
     Block *block  = static_cast<Block *>(argument);
 
+    // the step ticker may have started this block's moves already
+    bool started= false;
+    if(block == this->staged_block) {
+        started= this->move_switched;
+        this->staged_block= NULL;
+        this->move_switched= false;
+    }
+
     // Mark the new block as of interrest to us, handle blocks that have no axis moves properly (like Extrude blocks etc)
     bool take = false;
     if (block->millimeters > 0.0F) {
@@ -151,7 +184,8 @@ void Stepper::on_block_begin(void *argument)
     int most_steps_to_move = 0;
     for (size_t i = 0; i < THEKERNEL->robot->actuators.size(); i++) {
         if (block->steps[i] > 0) {
-            THEKERNEL->robot->actuators[i]->move(block->direction_bits[i], block->steps[i])->set_moved_last_block(true);
+            if(!started) THEKERNEL->robot->actuators[i]->move(block->direction_bits[i], block->steps[i]);
+            THEKERNEL->robot->actuators[i]->set_moved_last_block(true);
             int steps_to_move = THEKERNEL->robot->actuators[i]->get_steps_to_move();
             if (steps_to_move > most_steps_to_move) {
                 most_steps_to_move = steps_to_move;
@@ -168,6 +202,12 @@ void Stepper::on_block_begin(void *argument)
     // Setup acceleration for this block
     this->trapezoid_generator_reset();
 
+    // if we were decelerating for a feed hold when the last block ended carry on from the speed we had got down to
+    if(this->hold_state == HOLD_DECELERATING) {
+        float rate= this->hold_speed * block->nominal_rate / block->nominal_speed;
+        if(rate < this->trapezoid_adjusted_rate) this->trapezoid_adjusted_rate= rate;
+    }
+
     // Set the initial speed for this move
     this->trapezoid_generator_tick();
 
@@ -175,15 +215,89 @@ void Stepper::on_block_begin(void *argument)
     THEKERNEL->step_ticker->synchronize_acceleration(false);
 
     // set a flag to synchronize the acceleration timer with the deceleration step, and fire it immediately we get to that step
-    if( block->decelerate_after > 0 && block->decelerate_after+1 < this->main_stepper->steps_to_move ) {
+    if( block->decelerate_after > 0 && block->decelerate_after+1 < this->main_stepper->steps_to_move && block->decelerate_after+1 > this->main_stepper->stepped ) {
         this->main_stepper->signal_step= block->decelerate_after+1; // we make it +1 as deceleration does not start until steps > decelerate_after
     }
+
+    this->stage_next_block();
 }
 
 // Current block is discarded
 void Stepper::on_block_end(void *argument)
 {
+    if(this->hold_state == HOLD_DECELERATING && this->current_block != NULL) {
+        this->hold_speed= this->trapezoid_adjusted_rate * this->current_block->nominal_speed / this->current_block->nominal_rate;
+    }
     this->current_block = NULL; //stfu !
+
+    // ended the usual way, the next block sets its moves up itself
+    if(!this->move_switched) this->unstage();
+}
+
+// Stage the moves of the block queued after the executing one, so the step ticker can start them the moment this one
+// finishes, rather than after the end of block and begin block events have got round to us. Only a plain move with no
+// gcodes to execute is staged, anything else has to begin the usual way. Its entry speed is frozen as when it begins,
+// the planner still works its exit speed out for the blocks queued after it. The extruders set their own moves up in
+// on_block_begin() and are not staged, so while one is still moving the step ticker leaves the switch to the end of
+// block as before. Called at the priority of PendSV
+void Stepper::stage_next_block()
+{
+    if(this->staged_block != NULL || this->current_block == NULL || this->hold_state != NOT_HELD || this->stop_requested || this->halted) return;
+    if(THEKERNEL->get_feed_hold() || THEKERNEL->conveyor->is_flushing()) return;
+
+    Block *block= THEKERNEL->conveyor->get_block_after(this->current_block);
+    if(block == NULL || !block->is_ready || !block->gcodes.empty() || block->millimeters <= 0.0F) return;
+
+    // homing, it is driven one block at a time
+    for (auto a : THEKERNEL->robot->actuators) {
+        if(a->stop_pin != nullptr) return;
+    }
+
+    // from now on the planner leaves it alone, the same as when it begins
+    block->recalculate_flag= false;
+
+    uint32_t next= 0, current= 0;
+    float isps= block->initial_rate / (float)block->steps_event_count;
+    for (size_t i = 0; i < THEKERNEL->robot->actuators.size(); i++) {
+        StepperMotor *a= THEKERNEL->robot->actuators[i];
+        if(a->moving) current |= (1UL << a->index);
+        if(block->steps[i] > 0) {
+            a->stage_move(block->direction_bits[i], block->steps[i], isps * block->steps[i]);
+            next |= (1UL << a->index);
+        }
+    }
+    if(next == 0) return;
+
+    this->staged_block= block;
+    THEKERNEL->step_ticker->stage_moves(next, current);
+}
+
+// Forget the staged block unless the step ticker has already started it
+void Stepper::unstage()
+{
+    if(this->staged_block != NULL && !this->move_switched && THEKERNEL->step_ticker->unstage_moves()) {
+        this->staged_block= NULL;
+    }
+}
+
+// The step ticker has started the staged block's moves, called from PendSV. Release the block that just finished, which
+// begins the next one
+void Stepper::on_move_switched()
+{
+    this->move_switched= true;
+    if(this->current_block != NULL) {
+        this->current_block->release();
+    }
+
+    // on_block_begin() clears move_switched when the staged block begins
+    if(this->move_switched) {
+        // the queue was flushed rather than moving on to the staged block, stop what was started
+        for (auto a : THEKERNEL->robot->actuators) {
+            if(a->moving) a->move(a->direction, 0);
+        }
+        this->staged_block= NULL;
+        this->move_switched= false;
+    }
 }
 
 // When a stepper motor has finished it's assigned movement
@@ -210,33 +324,52 @@ uint32_t Stepper::stepper_motor_finished_move(uint32_t dummy)
 // NOTE caled at the same priority as PendSV so it may make that longer but it is better that having htis pre empted by pendsv
 void Stepper::trapezoid_generator_tick(void)
 {
-    // Do not do the accel math for nothing
-    if(this->current_block && this->main_stepper->moving ) {
+    // Do not do the accel math for nothing, nor for the block that just finished if the next one's moves have started
+    if(this->current_block && this->main_stepper->moving && !THEKERNEL->step_ticker->is_switching_moves()) {
 
         // Store this here because we use it a lot down there
         uint32_t current_steps_completed = this->main_stepper->stepped;
         float last_rate= trapezoid_adjusted_rate;
 
-        if( this->force_speed_update ) {
+        if(this->hold_state == HELD && !THEKERNEL->conveyor->is_flushing()) {
+            // motors are paused part way through this block, nothing to do until we are resumed
+            return;
+
+        } else if( this->force_speed_update ) {
             // Do not accel, just set the value
             this->force_speed_update = false;
             last_rate= -1;
 
         } else if(THEKERNEL->conveyor->is_flushing()) {
             // if we are flushing the queue, decelerate to 0 then finish this block
+            this->unstage();
             if (trapezoid_adjusted_rate > current_block->rate_delta * 1.5F) {
                 trapezoid_adjusted_rate -= current_block->rate_delta;
 
             } else if (trapezoid_adjusted_rate == current_block->rate_delta * 0.5F) {
                 for (auto i : THEKERNEL->robot->actuators) i->move(i->direction, 0); // stop motors
+                THEKERNEL->step_ticker->set_paused(false); // in case we were flushed while in a feed hold
+                this->hold_state= NOT_HELD;
+                this->stop_requested= false;
                 if (current_block) current_block->release();
-                THEKERNEL->call_event(ON_SPEED_CHANGE, 0); // tell others we stopped
+                this->speed_changed(true); // tell others we stopped
                 return;
 
             } else {
                 trapezoid_adjusted_rate = current_block->rate_delta * 0.5F;
             }
 
+        } else if(this->hold_state == HOLD_DECELERATING || THEKERNEL->get_feed_hold()) {
+            // feed hold, decelerate to a stop then pause the motors where they are, nothing in the queue is lost
+            this->hold_state= HOLD_DECELERATING;
+            this->unstage();
+            if (trapezoid_adjusted_rate > current_block->rate_delta * 1.5F) {
+                trapezoid_adjusted_rate -= current_block->rate_delta;
+            } else {
+                enter_hold();
+                return;
+            }
+
         } else if(current_steps_completed <= this->current_block->accelerate_until) {
             // If we are accelerating
             // Increase speed
@@ -269,7 +402,58 @@ void Stepper::trapezoid_generator_tick(void)
             // don't call this if speed did not change
             this->set_step_events_per_second(this->trapezoid_adjusted_rate);
         }
+
+        // the next block may have been queued since this one began
+        if(this->staged_block == NULL) this->stage_next_block();
+    }
+}
+
+// We have decelerated to a stop for a feed hold, stop the step ticker in the middle of the block.
+// Each motor keeps its step count so when resumed it finishes exactly the steps it was given
+void Stepper::enter_hold()
+{
+    THEKERNEL->step_ticker->set_paused(true);
+    this->hold_state= HELD;
+    this->trapezoid_adjusted_rate= 0;
+    this->set_step_events_per_second(0); // tell others we stopped
+}
+
+// Decelerate to a stop exactly as for a feed hold, but stay stopped until the queue is flushed (used to cancel a jog).
+// is_stopping() is true until we have stopped or run out of blocks
+void Stepper::decelerate_to_stop()
+{
+    // the block can end under us so check and set atomically
+    __disable_irq();
+    if(this->current_block != NULL) {
+        this->stop_requested= true;
+        if(this->hold_state == NOT_HELD) this->hold_state= HOLD_DECELERATING;
+        this->unstage();
     }
+    __enable_irq();
+}
+
+// Feed hold released, called from on_idle while the motors are paused
+void Stepper::resume_from_hold()
+{
+    // Replan the rest of the current block from a standstill, the planner can't touch it as it is executing.
+    // If it was stopped too close to its end it may not get back up to its exit speed, then the rest of the queue needs replanning too
+    float exit_speed= this->current_block->exit_speed;
+    this->current_block->calculate_resume_trapezoid(this->main_stepper->stepped);
+    if(this->current_block->exit_speed < exit_speed) {
+        THEKERNEL->planner->replan_after_hold();
+    }
+
+    // the acceleration tick can pre-empt us so setup the new speed atomically
+    __disable_irq();
+    this->hold_state= NOT_HELD;
+    this->trapezoid_generator_reset();
+    this->trapezoid_generator_tick();
+    if(this->current_block->decelerate_after+1 < this->main_stepper->steps_to_move) {
+        this->main_stepper->signal_step= this->current_block->decelerate_after+1;
+    }
+    __enable_irq();
+
+    THEKERNEL->step_ticker->set_paused(false);
 }
 
 // Initializes the trapezoid generator from the current block. Called whenever a new
@@ -293,7 +477,27 @@ void Stepper::set_step_events_per_second( float steps_per_second )
     }
 
     // Other modules might want to know the speed changed
-    THEKERNEL->call_event(ON_SPEED_CHANGE, this);
+    this->speed_changed(false);
+}
+
+bool Stepper::register_speed_change_handler(speed_change_handler_t fn, void *instance)
+{
+    if(this->num_speed_change_handlers >= max_speed_change_handlers) {
+        THEKERNEL->streams->printf("Error: too many modules following the speed, max is %d\n", max_speed_change_handlers);
+        return false;
+    }
+    // filled in before it is counted as the acceleration tick may be running
+    this->speed_change_handlers[this->num_speed_change_handlers].fn= fn;
+    this->speed_change_handlers[this->num_speed_change_handlers].instance= instance;
+    this->num_speed_change_handlers++;
+    return true;
+}
+
+void Stepper::speed_changed(bool stopped)
+{
+    for (int i = 0; i < this->num_speed_change_handlers; ++i) {
+        this->speed_change_handlers[i].fn(this->speed_change_handlers[i].instance, stopped);
+    }
 }
 
 
@@ -25,23 +25,53 @@ public:
     void on_gcode_received(void *argument);
     void on_gcode_execute(void *argument);
     void on_halt(void *argument);
+    void on_idle(void *argument);
 
     void trapezoid_generator_reset();
     void set_step_events_per_second(float);
     void trapezoid_generator_tick(void);
     uint32_t stepper_motor_finished_move(uint32_t dummy);
+    void on_move_switched();
     int config_step_timer( int cycles );
     void turn_enable_pins_on();
     void turn_enable_pins_off();
 
     float get_trapezoid_adjusted_rate() const { return trapezoid_adjusted_rate; }
     const Block *get_current_block() const { return current_block; }
+    bool is_held() const { return hold_state == HELD; }
+    void decelerate_to_stop();
+    bool is_stopping() const { return hold_state == HOLD_DECELERATING; }
+
+    // Called from the acceleration tick each time the speed changes, with stopped set when a flush has brought the
+    // motors to a stop. Only a few modules follow the speed so they are called directly instead of through an event
+    typedef void (*speed_change_handler_t)(void *instance, bool stopped);
+    bool register_speed_change_handler(speed_change_handler_t fn, void *instance);
 
 private:
+    void enter_hold();
+    void resume_from_hold();
+    void stage_next_block();
+    void unstage();
+    void speed_changed(bool stopped);
+
     Block *current_block;
+    Block *staged_block; // the next block, whose moves the step ticker starts as soon as the current block's finish
     float trapezoid_adjusted_rate;
+    float hold_speed; // speed in mm/sec carried over into the next block when decelerating for a feed hold
     StepperMotor *main_stepper;
 
+    enum HOLD_STATE { NOT_HELD, HOLD_DECELERATING, HELD };
+    volatile HOLD_STATE hold_state;
+    volatile bool stop_requested; // like a feed hold but we do not resume, the queue gets flushed instead
+    volatile bool move_switched;  // the step ticker started the staged block's moves, it has not begun yet
+
+    static const int max_speed_change_handlers= 8;
+    struct {
+        speed_change_handler_t fn;
+        void *instance;
+    } speed_change_handlers[max_speed_change_handlers];
+    volatile uint8_t num_speed_change_handlers;
+
     struct {
         bool enable_pins_status:1;
         bool force_speed_update:1;
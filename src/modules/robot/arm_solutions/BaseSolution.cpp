@@ -0,0 +1,48 @@
+#include <math.h>
+#include "BaseSolution.h"
+
+void BaseSolution::cartesian_line_to_actuator(const float start[], const float delta[], int n, ActuatorCoordinates actuator_mm[])
+{
+    for (int k = 0; k < n; k++) {
+        float p[3];
+        for (int i = 0; i < 3; i++)
+            p[i] = start[i] + delta[i] * k;
+        cartesian_to_actuator(p, actuator_mm[k]);
+    }
+}
+
+float BaseSolution::segment_deviation(const float a[], const ActuatorCoordinates &a_actuator, const float b[], const ActuatorCoordinates &b_actuator)
+{
+    // the actuators all move linearly between the ends, so halfway in actuator space is where the effector really is halfway through the segment
+    ActuatorCoordinates mid_actuator;
+    mid_actuator.fill(0);
+    for (size_t i = 0; i < get_actuator_count(); i++) {
+        mid_actuator[i] = (a_actuator[i] + b_actuator[i]) / 2.0F;
+    }
+
+    float mid[3];
+    actuator_to_cartesian(mid_actuator, mid);
+
+    float d2 = 0;
+    for (int i = 0; i < 3; i++) {
+        float d = mid[i] - (a[i] + b[i]) / 2.0F;
+        d2 += d * d;
+    }
+    return sqrtf(d2);
+}
+
+float BaseSolution::segment_length(const float start[], const ActuatorCoordinates &start_actuator, const float unit_vec[], float max_length, float max_error, float end[], ActuatorCoordinates &end_actuator)
+{
+    float l = max_length;
+    for (int tries = 0; tries < 5; ++tries) {
+        for (int i = 0; i < 3; i++)
+            end[i] = start[i] + unit_vec[i] * l;
+        cartesian_to_actuator(end, end_actuator);
+
+        float deviation = segment_deviation(start, start_actuator, end, end_actuator);
+        if(!(deviation > max_error)) break; // also stop on nan, somewhere it can't reach, nothing to be gained by splitting
+        // the deviation goes up with the square of the length, aim a little under so we don't just miss again
+        l *= fmaxf(0.1F, 0.9F * sqrtf(max_error / deviation));
+    }
+    return l;
+}
@@ -14,10 +14,20 @@ class BaseSolution {
         virtual ~BaseSolution() {};
         virtual void cartesian_to_actuator(const float[], ActuatorCoordinates &) = 0;
         virtual void actuator_to_cartesian(const ActuatorCoordinates &, float[]) = 0;
+        // convert the n points start, start + delta ... start + (n-1)*delta along a line to actuator positions,
+        // solutions that can do it cheaper than n calls to cartesian_to_actuator override this
+        virtual void cartesian_line_to_actuator(const float start[], const float delta[], int n, ActuatorCoordinates actuator_mm[]);
         typedef std::map<char, float> arm_options_t;
         virtual bool set_optional(const arm_options_t& options) { return false; };
         virtual bool get_optional(arm_options_t& options, bool force_all= false) { return false; };
         virtual size_t get_actuator_count() const { return 3; }
+
+        // how far the effector strays from the straight line a b when the actuators move linearly from a_actuator to b_actuator,
+        // measured at the midpoint, which is near enough the worst point of a segment short enough to be worth checking
+        float segment_deviation(const float a[], const ActuatorCoordinates &a_actuator, const float b[], const ActuatorCoordinates &b_actuator);
+        // the length of the next segment from start along unit_vec, no more than max_length, that deviates no more than max_error.
+        // end and end_actuator are set to where it ends
+        float segment_length(const float start[], const ActuatorCoordinates &start_actuator, const float unit_vec[], float max_length, float max_error, float end[], ActuatorCoordinates &end_actuator);
 };
 
 #endif
@@ -13,3 +13,12 @@ void CartesianSolution::actuator_to_cartesian( const ActuatorCoordinates &actuat
     cartesian_mm[BETA_STEPPER ] = actuator_mm[Y_AXIS];
     cartesian_mm[GAMMA_STEPPER] = actuator_mm[Z_AXIS];
 }
+
+void CartesianSolution::cartesian_line_to_actuator(const float start[], const float delta[], int n, ActuatorCoordinates actuator_mm[])
+{
+    for (int k = 0; k < n; k++) {
+        actuator_mm[k][ALPHA_STEPPER] = start[X_AXIS] + delta[X_AXIS] * k;
+        actuator_mm[k][BETA_STEPPER ] = start[Y_AXIS] + delta[Y_AXIS] * k;
+        actuator_mm[k][GAMMA_STEPPER] = start[Z_AXIS] + delta[Z_AXIS] * k;
+    }
+}
@@ -13,6 +13,7 @@ class CartesianSolution : public BaseSolution {
         CartesianSolution(Config*){};
         void cartesian_to_actuator( const float millimeters[], ActuatorCoordinates &steps ) override;
         void actuator_to_cartesian( const ActuatorCoordinates &steps, float millimeters[] ) override;
+        void cartesian_line_to_actuator(const float start[], const float delta[], int n, ActuatorCoordinates actuator_mm[]) override;
 };
 
 
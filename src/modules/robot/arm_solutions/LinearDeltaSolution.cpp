@@ -72,6 +72,32 @@ void LinearDeltaSolution::cartesian_to_actuator(const float cartesian_mm[], Actu
                                       ) + cartesian_mm[Z_AXIS];
 }
 
+// Along a line the term under each tower's sqrt is a quadratic in the point number, so it is stepped by forward differencing,
+// two adds per tower instead of working it out from scratch. The float error builds up as it goes so it is
+// worked out exactly again every 16 points, which keeps it well under a step.
+void LinearDeltaSolution::cartesian_line_to_actuator(const float start[], const float delta[], int n, ActuatorCoordinates actuator_mm[])
+{
+    const float tower_x[3] {delta_tower1_x, delta_tower2_x, delta_tower3_x};
+    const float tower_y[3] {delta_tower1_y, delta_tower2_y, delta_tower3_y};
+    const float dd = delta[X_AXIS] * delta[X_AXIS] + delta[Y_AXIS] * delta[Y_AXIS];
+
+    for (int tower = ALPHA_STEPPER; tower <= GAMMA_STEPPER; tower++) {
+        float r = 0, dr = 0;
+        for (int k = 0; k < n; k++) {
+            if((k & 15) == 0) {
+                float ax = tower_x[tower] - start[X_AXIS] - delta[X_AXIS] * k;
+                float ay = tower_y[tower] - start[Y_AXIS] - delta[Y_AXIS] * k;
+                r = this->arm_length_squared - ax * ax - ay * ay;
+                dr = 2.0F * (ax * delta[X_AXIS] + ay * delta[Y_AXIS]) - dd;
+            } else {
+                r += dr;
+                dr -= 2.0F * dd;
+            }
+            actuator_mm[k][tower] = sqrtf(r) + start[Z_AXIS] + delta[Z_AXIS] * k;
+        }
+    }
+}
+
 void LinearDeltaSolution::actuator_to_cartesian(const ActuatorCoordinates &actuator_mm, float cartesian_mm[] )
 {
     // from http://en.wikipedia.org/wiki/Circumscribed_circle#Barycentric_coordinates_from_cross-_and_dot-products
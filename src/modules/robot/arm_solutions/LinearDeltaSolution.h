@@ -10,6 +10,7 @@ class LinearDeltaSolution : public BaseSolution {
         LinearDeltaSolution(Config*);
         void cartesian_to_actuator(const float[], ActuatorCoordinates &) override;
         void actuator_to_cartesian(const ActuatorCoordinates &, float[] ) override;
+        void cartesian_line_to_actuator(const float start[], const float delta[], int n, ActuatorCoordinates actuator_mm[]) override;
 
         bool set_optional(const arm_options_t& options) override;
         bool get_optional(arm_options_t& options, bool force_all) override;
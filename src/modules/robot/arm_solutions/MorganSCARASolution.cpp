@@ -12,6 +12,7 @@
 //#include "StepperMotor.h"
 
 #include "libs/nuts_bolts.h"
+#include "libs/fast_trig.h"
 
 #include "libs/Config.h"
 
@@ -24,6 +25,7 @@
 #define morgan_homing_checksum        CHECKSUM("morgan_homing")
 #define morgan_undefined_min_checksum CHECKSUM("morgan_undefined_min")
 #define morgan_undefined_max_checksum CHECKSUM("morgan_undefined_max")
+#define morgan_fast_trig_checksum     CHECKSUM("morgan_fast_trig")
 
 #define SQ(x) powf(x, 2)
 #define ROUND(x, y) (roundf(x * 1e ## y) / 1e ## y)
@@ -47,6 +49,8 @@ MorganSCARASolution::MorganSCARASolution(Config* config)
     morgan_undefined_min  = config->value(morgan_undefined_min_checksum)->by_default(0.95f)->as_number();
     // max: head on maximum reach
     morgan_undefined_max  = config->value(morgan_undefined_max_checksum)->by_default(0.95f)->as_number();
+    // use the polynomial atan2 (error < 0.0021 degrees on the psi arm) instead of the much slower library one
+    fast_trig             = config->value(morgan_fast_trig_checksum)->by_default(false)->as_bool();
 
     init();
 }
@@ -93,8 +97,13 @@ void MorganSCARASolution::cartesian_to_actuator(const float cartesian_mm[], Actu
     SCARA_K1 = this->arm1_length+this->arm2_length*SCARA_C2;
     SCARA_K2 = this->arm2_length*SCARA_S2;
 
-    SCARA_theta = (atan2f(SCARA_pos[X_AXIS],SCARA_pos[Y_AXIS])-atan2f(SCARA_K1, SCARA_K2))*-1.0f;    // Morgan Thomas turns Theta in oposite direction
-    SCARA_psi   = atan2f(SCARA_S2,SCARA_C2);
+    if(this->fast_trig) {
+        SCARA_theta = (fast_atan2f(SCARA_pos[X_AXIS],SCARA_pos[Y_AXIS])-fast_atan2f(SCARA_K1, SCARA_K2))*-1.0f;
+        SCARA_psi   = fast_atan2f(SCARA_S2,SCARA_C2);
+    } else {
+        SCARA_theta = (atan2f(SCARA_pos[X_AXIS],SCARA_pos[Y_AXIS])-atan2f(SCARA_K1, SCARA_K2))*-1.0f;    // Morgan Thomas turns Theta in oposite direction
+        SCARA_psi   = atan2f(SCARA_S2,SCARA_C2);
+    }
 
 
     actuator_mm[ALPHA_STEPPER] = to_degrees(SCARA_theta);             // Multiply by 180/Pi  -  theta is support arm angle
@@ -27,6 +27,7 @@ class MorganSCARASolution : public BaseSolution {
         float morgan_undefined_min;
         float morgan_undefined_max;
         float slow_rate;
+        bool fast_trig;
 };
 
 #endif // MORGANSCARASOLUTION_H
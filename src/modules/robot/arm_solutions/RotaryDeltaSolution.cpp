@@ -7,6 +7,7 @@
 #include "libs/nuts_bolts.h"
 #include "libs/Config.h"
 #include "libs/utils.h"
+#include "libs/fast_trig.h"
 #include "StreamOutputPool.h"
 #include <fastmath.h>
 
@@ -20,6 +21,7 @@
 #define tool_offset_checksum            CHECKSUM("delta_tool_offset")
 
 #define delta_mirror_xy_checksum        CHECKSUM("delta_mirror_xy")
+#define delta_fast_trig_checksum        CHECKSUM("delta_fast_trig")
 
 const static float pi     = 3.14159265358979323846;    // PI
 const static float two_pi = 2 * pi;
@@ -56,6 +58,9 @@ RotaryDeltaSolution::RotaryDeltaSolution(Config *config)
     // mirror the XY axis
     mirror_xy= config->value(delta_mirror_xy_checksum)->by_default(true)->as_bool();
 
+    // use the polynomial atan (error < 0.0007 degrees) instead of the much slower library one
+    fast_trig= config->value(delta_fast_trig_checksum)->by_default(false)->as_bool();
+
     debug_flag= false;
     init();
 }
@@ -76,7 +81,7 @@ int RotaryDeltaSolution::delta_calcAngleYZ(float x0, float y0, float z0, float &
     float yj = (y1 - a * b - sqrtf(d)) / (b * b + 1.0F);               // choosing outer point
     float zj = a + b * yj;
 
-    theta = 180.0F * atanf(-zj / (y1 - yj)) / pi + ((yj > y1) ? 180.0F : 0.0F);
+    theta = 180.0F * (fast_trig ? fast_atanf(-zj / (y1 - yj)) : atanf(-zj / (y1 - yj))) / pi + ((yj > y1) ? 180.0F : 0.0F);
     return 0;
 }
 
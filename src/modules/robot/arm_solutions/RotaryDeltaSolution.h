@@ -33,6 +33,7 @@ class RotaryDeltaSolution : public BaseSolution {
         struct {
             bool debug_flag:1;
             bool mirror_xy:1;
+            bool fast_trig:1;
         };
 };
 #endif // RotaryDeltaSolution_H
@@ -19,6 +19,7 @@
 #include "Stepper.h"
 #include "Config.h"
 #include "SlowTicker.h"
+#include "InputScanner.h"
 #include "Planner.h"
 #include "checksumm.h"
 #include "utils.h"
@@ -85,6 +86,7 @@
 #define gamma_homing_retract_mm_checksum    CHECKSUM("gamma_homing_retract_mm")
 
 #define endstop_debounce_count_checksum  CHECKSUM("endstop_debounce_count")
+#define endstop_debounce_steps_checksum  CHECKSUM("endstop_debounce_steps")
 
 #define alpha_homing_direction_checksum  CHECKSUM("alpha_homing_direction")
 #define beta_homing_direction_checksum   CHECKSUM("beta_homing_direction")
@@ -125,6 +127,7 @@ Endstops::Endstops()
 {
     this->status = NOT_HOMING;
     home_offset[0] = home_offset[1] = home_offset[2] = 0.0F;
+    for (int n = 0; n < 6; ++n) limit_input[n] = -1;
 }
 
 void Endstops::on_module_loaded()
@@ -178,6 +181,8 @@ void Endstops::load_config()
     this->retract_mm[2] = THEKERNEL->config->value(gamma_homing_retract_mm_checksum   )->by_default(this->retract_mm[2])->as_number();
 
     this->debounce_count  = THEKERNEL->config->value(endstop_debounce_count_checksum    )->by_default(100)->as_number();
+    // when homing the endstops are read by the step interrupt before every step, and must read triggered this many steps in a row
+    this->debounce_steps  = THEKERNEL->config->value(endstop_debounce_steps_checksum    )->by_default(2)->as_number();
 
     // get homing direction and convert to boolean where true is home to min, and false is home to max
     int home_dir                    = get_checksum(THEKERNEL->config->value(alpha_homing_direction_checksum)->by_default("home_to_min")->as_string());
@@ -236,6 +241,11 @@ void Endstops::load_config()
             this->limit_enable[Y_AXIS] = true;
             this->limit_enable[Z_AXIS] = true;
         }
+
+        // the limit switches are debounced by the input scanner, and checked against it when moving
+        for (int n = 0; n < 6; ++n) {
+            if(this->limit_enable[n % 3] && this->limit_input[n] < 0) this->limit_input[n]= THEKERNEL->input_scanner->attach(this->pins[n]);
+        }
     }
 
     //
@@ -299,7 +309,7 @@ void Endstops::on_idle(void *argument)
             // check min and max endstops
             for (int i : minmax) {
                 int n = c + i;
-                if(debounced_get(n)) {
+                if(this->limit_input[n] >= 0 && THEKERNEL->input_scanner->get(this->limit_input[n])) {
                     // endstop triggered
                     THEKERNEL->streams->printf("Limit switch %s was hit - reset or M999 required\n", endstop_names[n]);
                     this->status = LIMIT_TRIGGERED;
@@ -379,33 +389,45 @@ void Endstops::move_to_origin(char axes_to_move)
     this->status = NOT_HOMING;
 }
 
+// have the step interrupt check the endstop before each step of the homing axes, so each stops within a step of its
+// endstop triggering whatever the speed
+void Endstops::stop_on_endstops(char axes_to_move)
+{
+    for ( int c = X_AXIS; c <= Z_AXIS; c++ ) {
+        if ( ( axes_to_move >> c ) & 1 ) {
+            STEPPER[c]->set_stop_pin(&this->pins[c + (this->home_direction[c] ? 0 : 3)], this->debounce_steps);
+        }
+    }
+}
+
+// the axes home at the same time and are each stopped by the step interrupt, so just wait for them all to stop
 bool Endstops::wait_for_homed(char axes_to_move)
 {
     bool running = true;
-    unsigned int debounce[3] = {0, 0, 0};
     while (running) {
         running = false;
         THEKERNEL->call_event(ON_IDLE);
 
         // check if on_halt (eg kill)
-        if(THEKERNEL->is_halted()) return false;
+        if(THEKERNEL->is_halted()) break;
 
         for ( int c = X_AXIS; c <= Z_AXIS; c++ ) {
-            if ( ( axes_to_move >> c ) & 1 ) {
-                if ( this->pins[c + (this->home_direction[c] ? 0 : 3)].get() ) {
-                    if ( debounce[c] < debounce_count ) {
-                        debounce[c]++;
-                        running = true;
-                    } else if ( STEPPER[c]->is_moving() ) {
-                        STEPPER[c]->move(0, 0);
-                        axes_to_move &= ~(1 << c); // no need to check it again
-                    }
-                } else {
-                    // The endstop was not hit yet
-                    running = true;
-                    debounce[c] = 0;
-                }
-            }
+            if ( (( axes_to_move >> c ) & 1) && STEPPER[c]->is_moving() ) running = true;
+        }
+    }
+
+    // stop checking so they can back off the endstops
+    for ( int c = X_AXIS; c <= Z_AXIS; c++ ) {
+        if ( ( axes_to_move >> c ) & 1 ) STEPPER[c]->set_stop_pin(nullptr);
+    }
+    if(THEKERNEL->is_halted()) return false;
+
+    // an axis that ran out of steps or was stopped some other way never found its endstop, so it is not homed
+    for ( int c = X_AXIS; c <= Z_AXIS; c++ ) {
+        if ( (( axes_to_move >> c ) & 1) && !STEPPER[c]->was_stopped_by_pin() ) {
+            THEKERNEL->streams->printf("Homing failed, %c did not reach its endstop - reset or M999 required\n", 'X' + c);
+            THEKERNEL->call_event(ON_HALT, nullptr);
+            return false;
         }
     }
     return true;
@@ -419,6 +441,7 @@ void Endstops::do_homing_cartesian(char axes_to_move)
     // this homing works for cartesian and delta printers
     // Start moving the axes to the origin
     this->status = MOVING_TO_ENDSTOP_FAST;
+    stop_on_endstops(axes_to_move);
     for ( int c = X_AXIS; c <= Z_AXIS; c++ ) {
         if ( ( axes_to_move >> c) & 1 ) {
             this->feed_rate[c] = this->fast_rates[c];
@@ -452,6 +475,7 @@ void Endstops::do_homing_cartesian(char axes_to_move)
 
     // Start moving the axes to the origin slowly
     this->status = MOVING_TO_ENDSTOP_SLOW;
+    stop_on_endstops(axes_to_move);
     for ( int c = X_AXIS; c <= Z_AXIS; c++ ) {
         if ( ( axes_to_move >> c ) & 1 ) {
             this->feed_rate[c] = this->slow_rates[c];
@@ -612,6 +636,7 @@ void Endstops::home(char axes_to_move)
 
     // make sure all steppers are off (especially if aborted)
     for ( int c = X_AXIS; c <= Z_AXIS; c++ ) {
+        STEPPER[c]->set_stop_pin(nullptr);
         STEPPER[c]->move(0, 0);
     }
     this->status = NOT_HOMING;
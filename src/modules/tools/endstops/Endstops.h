@@ -28,6 +28,7 @@ class Endstops : public Module{
         void home(char axes_to_move);
         void do_homing_cartesian(char axes_to_move);
         void do_homing_corexy(char axes_to_move);
+        void stop_on_endstops(char axes_to_move);
         bool wait_for_homed(char axes_to_move);
         bool wait_for_homed_corexy(int axis);
         void corexy_home(int home_axis, bool dirx, bool diry, float fast_rate, float slow_rate, unsigned int retract_steps);
@@ -48,11 +49,13 @@ class Endstops : public Module{
         float saved_position[3]{0}; // save G28 (in grbl mode)
 
         unsigned int  debounce_count;
+        uint8_t debounce_steps;
         float  retract_mm[3];
         float  trim_mm[3];
         float  fast_rates[3];
         float  slow_rates[3];
         Pin    pins[6];
+        int8_t limit_input[6]; // input scanner ids of the limit switches
         volatile float feed_rate[3];
         struct {
             bool is_corexy:1;
@@ -147,10 +147,12 @@ void Extruder::on_module_loaded()
     this->register_for_event(ON_GCODE_RECEIVED);
     this->register_for_event(ON_GCODE_EXECUTE);
     this->register_for_event(ON_HALT);
-    this->register_for_event(ON_SPEED_CHANGE);
     this->register_for_event(ON_GET_PUBLIC_DATA);
     this->register_for_event(ON_SET_PUBLIC_DATA);
 
+    // Follow the robot's speed
+    THEKERNEL->stepper->register_speed_change_handler([](void *extruder, bool stopped) { static_cast<Extruder *>(extruder)->on_speed_change(stopped); }, this);
+
     // Update speed every *acceleration_ticks_per_second*
     THEKERNEL->step_ticker->register_acceleration_tick_handler([this]() {
         acceleration_tick();
@@ -798,7 +800,7 @@ void Extruder::on_block_begin(void *argument)
         this->stepper_motor->move( (this->travel_distance > 0), steps_to_step);
 
         if(this->mode == FOLLOW) {
-            on_speed_change(this); // set initial speed
+            on_speed_change(false); // set initial speed
             this->stepper_motor->set_moved_last_block(true);
         } else {
             // SOLO
@@ -849,16 +851,16 @@ void Extruder::acceleration_tick(void)
 }
 
 // Speed has been updated for the robot's stepper, we must update accordingly
-void Extruder::on_speed_change( void *argument )
+void Extruder::on_speed_change( bool stopped )
 {
     // Avoid trying to work when we really shouldn't ( between blocks or re-entry )
     if(!this->enabled || this->current_block == NULL || this->mode != FOLLOW || !this->stepper_motor->is_moving()) {
         return;
     }
 
-    // if we are flushing the queue we need to stop the motor when it has decelerated to zero, we get this call with argumnet == 0 when this happens
+    // if we are flushing the queue we need to stop the motor when it has decelerated to zero, we get this call with stopped set when this happens
     // this is what steppermotor does
-    if(argument == 0) {
+    if(stopped) {
         this->stepper_motor->move(0, 0);
         this->current_block->release();
         this->current_block = NULL;
@@ -36,7 +36,7 @@ class Extruder : public Tool {
         void     on_block_begin(void* argument);
         void     on_block_end(void* argument);
         void     on_halt(void* argument);
-        void     on_speed_change(void* argument);
+        void     on_speed_change(bool stopped);
         void     acceleration_tick(void);
         uint32_t stepper_motor_finished_move(uint32_t dummy);
         Block*   append_empty_block();
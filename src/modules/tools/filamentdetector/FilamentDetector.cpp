@@ -11,6 +11,7 @@
 #include "checksumm.h"
 #include "ConfigValue.h"
 #include "SlowTicker.h"
+#include "InputScanner.h"
 #include "PublicData.h"
 #include "StreamOutputPool.h"
 #include "StreamOutput.h"
@@ -62,8 +63,8 @@ void FilamentDetector::on_module_loaded()
     // optional bulge detector
     bulge_pin.from_string( THEKERNEL->config->value(filament_detector_checksum, bulge_pin_checksum)->by_default("nc" )->as_string())->as_input();
     if(bulge_pin.connected()) {
-        // input pin polling
-        THEKERNEL->slow_ticker->attach( 100, this, &FilamentDetector::button_tick);
+        // debounced input pin changes
+        this->bulge_input= THEKERNEL->input_scanner->attach(this->bulge_pin, [this](bool state) { bulge_pin_changed(state); });
     }
 
     //Valid configurations contain an encoder pin, a bulge pin or both.
@@ -119,6 +120,8 @@ void FilamentDetector::on_console_line_received( void *argument )
         this->pulses= 0;
         e_last_moved= NAN;
         suspended= false;
+        // the scanner only reports changes, so if the bulge is still there raise it again
+        if(this->bulge_input >= 0 && THEKERNEL->input_scanner->get(this->bulge_input)) bulge_pin_changed(true);
     }
 }
 
@@ -233,15 +236,11 @@ void FilamentDetector::check_encoder()
     }
 }
 
-uint32_t FilamentDetector::button_tick(uint32_t dummy)
+void FilamentDetector::bulge_pin_changed(bool state)
 {
-    if(!bulge_pin.connected() || suspended || !active) return 0;
+    if(!state || suspended || !active) return;
 
-    if(bulge_pin.get()) {
-        // we got a trigger from the bulge detector
-        this->filament_out_alarm= true;
-        this->bulge_detected= true;
-    }
-
-    return 0;
+    // we got a trigger from the bulge detector
+    this->filament_out_alarm= true;
+    this->bulge_detected= true;
 }
@@ -28,11 +28,12 @@ private:
     void on_pin_rise();
     void check_encoder();
     void send_command(std::string msg, StreamOutput *stream);
-    uint32_t button_tick(uint32_t dummy);
+    void bulge_pin_changed(bool state);
     float get_emove();
 
     mbed::InterruptIn *encoder_pin{0};
     Pin bulge_pin;
+    int bulge_input{-1};
     float e_last_moved{0};
     std::atomic_uint pulses{0};
     float pulses_per_mm{0};
@@ -98,10 +98,11 @@ void Laser::on_module_loaded() {
 
     //register for events
     this->register_for_event(ON_GCODE_EXECUTE);
-    this->register_for_event(ON_SPEED_CHANGE);
     this->register_for_event(ON_BLOCK_BEGIN);
     this->register_for_event(ON_BLOCK_END);
     this->register_for_event(ON_HALT);
+
+    THEKERNEL->stepper->register_speed_change_handler([](void *laser, bool) { static_cast<Laser *>(laser)->on_speed_change(); }, this);
 }
 
 // Turn laser off laser at the end of a move
@@ -151,7 +152,7 @@ void Laser::on_gcode_execute(void* argument){
 }
 
 // We follow the stepper module here, so speed must be proportional
-void Laser::on_speed_change(void* argument){
+void Laser::on_speed_change(){
     if( this->laser_on ){
         this->set_proportional_power();
     }
@@ -23,7 +23,7 @@ class Laser : public Module{
         void on_block_end(void* argument);
         void on_block_begin(void* argument);
         void on_gcode_execute(void* argument);
-        void on_speed_change(void* argument);
+        void on_speed_change();
         void on_halt(void* argument);
 
     private:
@@ -15,6 +15,7 @@
 #include "PublicDataRequest.h"
 #include "SwitchPublicAccess.h"
 #include "SlowTicker.h"
+#include "InputScanner.h"
 #include "Config.h"
 #include "Gcode.h"
 #include "checksumm.h"
@@ -204,8 +205,8 @@ void Switch::on_config_reload(void *argument)
     if(input_pin.connected()) {
         // set to initial state
         this->input_pin_state = this->input_pin.get();
-        // input pin polling
-        THEKERNEL->slow_ticker->attach( 100, this, &Switch::pinpoll_tick);
+        // debounced input pin changes
+        THEKERNEL->input_scanner->attach(this->input_pin, [this](bool state) { input_pin_changed(state); });
     }
 
     if(this->output_type == SIGMADELTA) {
@@ -373,34 +374,26 @@ void Switch::on_main_loop(void *argument)
     }
 }
 
-// TODO Make this use InterruptIn
-// Check the state of the button and act accordingly
-uint32_t Switch::pinpoll_tick(uint32_t dummy)
+// Called from the input scanner when the debounced state of the button changes, act accordingly
+void Switch::input_pin_changed(bool current_state)
 {
-    if(!input_pin.connected()) return 0;
-
-    // If pin changed
-    bool current_state = this->input_pin.get();
-    if(this->input_pin_state != current_state) {
-        this->input_pin_state = current_state;
-        // If pin high
-        if( this->input_pin_state ) {
-            // if switch is a toggle switch
-            if( this->input_pin_behavior == toggle_checksum ) {
-                this->flip();
-                // else default is momentary
-            } else {
-                this->flip();
-            }
-            // else if button released
+    this->input_pin_state = current_state;
+    // If pin high
+    if( this->input_pin_state ) {
+        // if switch is a toggle switch
+        if( this->input_pin_behavior == toggle_checksum ) {
+            this->flip();
+            // else default is momentary
         } else {
-            // if switch is momentary
-            if( this->input_pin_behavior == momentary_checksum ) {
-                this->flip();
-            }
+            this->flip();
+        }
+        // else if button released
+    } else {
+        // if switch is momentary
+        if( this->input_pin_behavior == momentary_checksum ) {
+            this->flip();
         }
     }
-    return 0;
 }
 
 void Switch::flip()
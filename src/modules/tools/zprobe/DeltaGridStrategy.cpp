@@ -40,6 +40,9 @@
     Optionally an initial_height can be set that tell the intial probe where to stop the fast decent before it probes, this should be around 5-10mm above the bed
       leveling-strategy.delta-grid.initial_height  10
 
+    The grid is interpolated bilinearly by default, a smoother Catmull-Rom bicubic surface can be used instead but needs four times the memory
+      leveling-strategy.delta-grid.bicubic  false
+
 
     Usage
     -----
@@ -50,7 +53,7 @@
         optional parameters {{Jn}} sets the radius for this probe, which gets saved with M375
 
     M370 clears the grid and turns off compensation
-    M374 Save grid to /sd/delta.grid
+    M374 Save grid to /sd/delta.grid, as a binary mesh file with a CRC (grids saved by older versions still load)
     M374.1 delete /sd/delta.grid
     M375 Load the grid from /sd/delta.grid and enable compensation
     M375.1 display the current grid
@@ -78,8 +81,10 @@
 #include "nuts_bolts.h"
 #include "utils.h"
 #include "platform_memory.h"
+#include "BedMesh.h"
 
 #include <string>
+#include <vector>
 #include <algorithm>
 #include <cstdlib>
 #include <cmath>
@@ -90,6 +95,7 @@
 #define save_checksum                CHECKSUM("save")
 #define probe_offsets_checksum       CHECKSUM("probe_offsets")
 #define initial_height_checksum      CHECKSUM("initial_height")
+#define bicubic_checksum             CHECKSUM("bicubic")
 
 #define GRIDFILE "/sd/delta.grid"
 
@@ -100,7 +106,7 @@ DeltaGridStrategy::DeltaGridStrategy(ZProbe *zprobe) : LevelingStrategy(zprobe)
 
 DeltaGridStrategy::~DeltaGridStrategy()
 {
-    if(grid != nullptr) AHB0.dealloc(grid);
+    delete grid;
 }
 
 bool DeltaGridStrategy::handleConfig()
@@ -109,6 +115,7 @@ bool DeltaGridStrategy::handleConfig()
     grid_size = THEKERNEL->config->value(leveling_strategy_checksum, delta_grid_leveling_strategy_checksum, grid_size_checksum)->by_default(7)->as_number();
     tolerance = THEKERNEL->config->value(leveling_strategy_checksum, delta_grid_leveling_strategy_checksum, tolerance_checksum)->by_default(0.03F)->as_number();
     save = THEKERNEL->config->value(leveling_strategy_checksum, delta_grid_leveling_strategy_checksum, save_checksum)->by_default(false)->as_bool();
+    bicubic = THEKERNEL->config->value(leveling_strategy_checksum, delta_grid_leveling_strategy_checksum, bicubic_checksum)->by_default(false)->as_bool();
 
     // the initial height above the bed we stop the intial move down after home to find the bed
     // this should be a height that is enough that the probe will not hit the bed and is an offset from max_z (can be set to 0 if max_z takes into account the probe offset)
@@ -124,7 +131,12 @@ bool DeltaGridStrategy::handleConfig()
     }
 
     // allocate in AHB0
-    grid= (float *)AHB0.alloc(grid_size * grid_size * sizeof(float));
+    grid= new BedMesh(AHB0);
+    if(!grid->allocate(grid_size, grid_size, bicubic)) {
+        THEKERNEL->streams->printf("error:delta-grid not enough memory for a %dx%d grid\n", grid_size, grid_size);
+        return false;
+    }
+    grid->set_bounds(-grid_radius, -grid_radius, grid_radius, grid_radius);
 
     reset_bed_level();
 
@@ -133,43 +145,47 @@ bool DeltaGridStrategy::handleConfig()
 
 void DeltaGridStrategy::save_grid(StreamOutput *stream)
 {
-    if(isnan(grid[0])) {
+    if(isnan(grid->get(0, 0))) {
         stream->printf("error:No grid to save\n");
         return;
     }
 
-    FILE *fp = fopen(GRIDFILE, "w");
-    if(fp == NULL) {
-        stream->printf("error:Failed to open grid file %s\n", GRIDFILE);
+    const char *error= grid->save(GRIDFILE);
+    if(error != nullptr) {
+        stream->printf("error:Failed to save grid %s: %s\n", GRIDFILE, error);
         return;
     }
+    stream->printf("grid saved to %s\n", GRIDFILE);
+}
 
-    if(fwrite(&grid_size, sizeof(uint8_t), 1, fp) != 1) {
-        stream->printf("error:Failed to write grid size\n");
-        fclose(fp);
-        return;
+bool DeltaGridStrategy::load_grid(StreamOutput *stream)
+{
+    // grids saved before the binary mesh file are still read the old way
+    if(!BedMesh::is_mesh_file(GRIDFILE)) return load_legacy_grid(stream);
+
+    float z_offset;
+    const char *error= grid->load(GRIDFILE, z_offset);
+    if(error == nullptr && grid->get_nx() != grid_size) error= "grid size is different to config";
+    if(error != nullptr) {
+        if(stream != nullptr) stream->printf("error:Failed to load grid %s: %s\n", GRIDFILE, error);
+        // leave a cleared grid of the configured size
+        if(grid->get_nx() != grid_size) grid->allocate(grid_size, grid_size, bicubic);
+        grid->set_bounds(-grid_radius, -grid_radius, grid_radius, grid_radius);
+        reset_bed_level();
+        return false;
     }
 
-    if(fwrite(&grid_radius, sizeof(float), 1, fp) != 1) {
-        stream->printf("error:Failed to write grid radius\n");
-        fclose(fp);
-        return;
+    float radius= grid->get_x(grid_size - 1);
+    if(fabsf(radius - grid_radius) > 0.0001F) {
+        if(stream != nullptr) stream->printf("warning:grid radius is different read %f - config %f, overriding config\n", radius, grid_radius);
+        grid_radius= radius;
     }
 
-    for (int y = 0; y < grid_size; y++) {
-        for (int x = 0; x < grid_size; x++) {
-            if(fwrite(&grid[x + (grid_size*y)], sizeof(float), 1, fp) != 1) {
-                stream->printf("error:Failed to write grid\n");
-                fclose(fp);
-                return;
-            }
-        }
-    }
-    stream->printf("grid saved to %s\n", GRIDFILE);
-    fclose(fp);
+    if(stream != nullptr) stream->printf("grid loaded from %s with radius %f and size %d\n", GRIDFILE, grid_radius, grid_size);
+    return true;
 }
 
-bool DeltaGridStrategy::load_grid(StreamOutput *stream)
+bool DeltaGridStrategy::load_legacy_grid(StreamOutput *stream)
 {
     FILE *fp = fopen(GRIDFILE, "r");
     if(fp == NULL) {
@@ -201,15 +217,18 @@ bool DeltaGridStrategy::load_grid(StreamOutput *stream)
     if(radius != grid_radius) {
         if(stream != nullptr) stream->printf("warning:grid radius is different read %f - config %f, overriding config\n", radius, grid_radius);
         grid_radius= radius;
+        grid->set_bounds(-grid_radius, -grid_radius, grid_radius, grid_radius);
     }
 
     for (int y = 0; y < grid_size; y++) {
         for (int x = 0; x < grid_size; x++) {
-            if(fread(&grid[x + (grid_size*y)], sizeof(float), 1, fp) != 1) {
+            float z;
+            if(fread(&z, sizeof(float), 1, fp) != 1) {
                 if(stream != nullptr) stream->printf("error:Failed to read grid\n");
                 fclose(fp);
                 return false;
             }
+            grid->set(x, y, z);
         }
     }
     if(stream != nullptr) stream->printf("grid loaded from %s with radius %f and size %d\n", GRIDFILE, grid_radius, grid_size);
@@ -217,6 +236,24 @@ bool DeltaGridStrategy::load_grid(StreamOutput *stream)
     return true;
 }
 
+// the points of an n by n grid spanning -radius to radius that are within radius of the centre, as x and y indices.
+// They are in serpentine order so every travel is to a neighbour, or at worst across the corner cut off by the radius
+static std::vector<std::pair<uint8_t, uint8_t>> serpentine_points(int n, float radius)
+{
+    std::vector<std::pair<uint8_t, uint8_t>> points;
+    float d= ((radius*2) / (n - 1));
+    for (int c = 0; c < n; ++c) {
+        float y = -radius + d*c;
+        for (int i = 0; i < n; ++i) {
+            int r= (c % 2) ? i : n - 1 - i;
+            float x = -radius + d*r;
+            // Avoid probing the corners (outside the round or hexagon print surface) on a delta printer.
+            if (sqrtf(x*x + y*y) <= radius) points.push_back(std::make_pair(r, c));
+        }
+    }
+    return points;
+}
+
 bool DeltaGridStrategy::probe_grid(int n, float radius, StreamOutput *stream)
 {
     if(n < 5) {
@@ -228,20 +265,25 @@ bool DeltaGridStrategy::probe_grid(int n, float radius, StreamOutput *stream)
     if(isnan(initial_z)) return false;
 
     float d= ((radius*2) / (n - 1));
+    auto points= serpentine_points(n, radius);
+    std::vector<float> z(n*n, 0.0F);
+
+    // each probe queues the lift and travel to the next point
+    zprobe->coordinated_move(-radius + d*points[0].first, -radius + d*points[0].second, NAN, zprobe->getFastFeedrate());
+    for (size_t i = 0; i < points.size(); ++i) {
+        float nx= NAN, ny= NAN;
+        if(i+1 < points.size()) {
+            nx= -radius + d*points[i+1].first;
+            ny= -radius + d*points[i+1].second;
+        }
+        int s;
+        if(!zprobe->probe_and_move(s, nx, ny)) return false;
+        z[points[i].first + n*points[i].second] = zprobe->getProbeHeight() - zprobe->zsteps_to_mm(s);
+    }
 
     for (int c = 0; c < n; ++c) {
-        float y = -radius + d*c;
         for (int r = 0; r < n; ++r) {
-            float x = -radius + d*r;
-            // Avoid probing the corners (outside the round or hexagon print surface) on a delta printer.
-            float distance_from_center = sqrtf(x*x + y*y);
-            float z= 0.0F;
-            if (distance_from_center <= radius) {
-                int s;
-                if(!zprobe->doProbeAt(s, x, y)) return false;
-                z = zprobe->getProbeHeight() - zprobe->zsteps_to_mm(s);
-            }
-            stream->printf("%8.4f ", z);
+            stream->printf("%8.4f ", z[r + n*c]);
         }
         stream->printf("\n");
     }
@@ -349,7 +391,7 @@ bool DeltaGridStrategy::handleGcode(Gcode *gcode)
             std::tie(x, y, z) = probe_offsets;
             gcode->stream->printf(";Probe offsets:\nM565 X%1.5f Y%1.5f Z%1.5f\n", x, y, z);
             if(save) {
-                if(!isnan(grid[0])) gcode->stream->printf(";Load saved grid\nM375\n");
+                if(!isnan(grid->get(0, 0))) gcode->stream->printf(";Load saved grid\nM375\n");
                 else if(gcode->m == 503) gcode->stream->printf(";WARNING No grid to save\n");
             }
             return true;
@@ -377,11 +419,15 @@ bool DeltaGridStrategy::handleGcode(Gcode *gcode)
 void DeltaGridStrategy::setAdjustFunction(bool on)
 {
     if(on) {
+        // work out the cell polynomials once here rather than on every move
+        grid->build();
         // set the compensationTransform in robot
+        THEKERNEL->robot->compensation_mesh = grid;
         THEKERNEL->robot->compensationTransform = [this](float target[3]) { doCompensation(target); };
     } else {
         // clear it
         THEKERNEL->robot->compensationTransform = nullptr;
+        THEKERNEL->robot->compensation_mesh = nullptr;
     }
 }
 
@@ -419,6 +465,7 @@ bool DeltaGridStrategy::doProbe(Gcode *gc)
     reset_bed_level();
 
     if(gc->has_letter('J')) grid_radius = gc->get_value('J'); // override default probe radius, will get saved
+    grid->set_bounds(-grid_radius, -grid_radius, grid_radius, grid_radius);
 
     float radius = grid_radius;
     // find bed, and leave probe probe height above bed
@@ -430,38 +477,33 @@ bool DeltaGridStrategy::doProbe(Gcode *gc)
 
     gc->stream->printf("Probe start ht is %f mm, probe radius is %f mm, grid size is %dx%d\n", initial_z, radius, grid_size, grid_size);
 
-    // do first probe for 0,0
+    auto points= serpentine_points(grid_size, radius);
+    auto probe_x= [this](int x) { return LEFT_PROBE_BED_POSITION + AUTO_BED_LEVELING_GRID_X * x; };
+    auto probe_y= [this](int y) { return FRONT_PROBE_BED_POSITION + AUTO_BED_LEVELING_GRID_Y * y; };
+
+    // do first probe for 0,0, each probe queues the lift and travel to the next point so they blend together
     int s;
-    if(!zprobe->doProbeAt(s, -X_PROBE_OFFSET_FROM_EXTRUDER, -Y_PROBE_OFFSET_FROM_EXTRUDER)) return false;
+    zprobe->coordinated_move(-X_PROBE_OFFSET_FROM_EXTRUDER, -Y_PROBE_OFFSET_FROM_EXTRUDER, NAN, zprobe->getFastFeedrate());
+    if(!zprobe->probe_and_move(s, probe_x(points[0].first) - X_PROBE_OFFSET_FROM_EXTRUDER, probe_y(points[0].second) - Y_PROBE_OFFSET_FROM_EXTRUDER)) return false;
     float z_reference = zprobe->getProbeHeight() - zprobe->zsteps_to_mm(s); // this should be zero
     gc->stream->printf("probe at 0,0 is %f mm\n", z_reference);
 
     // probe all the points in the grid within the given radius
-    for (int yCount = 0; yCount < grid_size; yCount++) {
-        float yProbe = FRONT_PROBE_BED_POSITION + AUTO_BED_LEVELING_GRID_Y * yCount;
-        int xStart, xStop, xInc;
-        if (yCount % 2) {
-            xStart = 0;
-            xStop = grid_size;
-            xInc = 1;
-        } else {
-            xStart = grid_size - 1;
-            xStop = -1;
-            xInc = -1;
+    for (size_t i = 0; i < points.size(); ++i) {
+        int xCount= points[i].first, yCount= points[i].second;
+        float xProbe = probe_x(xCount);
+        float yProbe = probe_y(yCount);
+
+        float nx= NAN, ny= NAN;
+        if(i+1 < points.size()) {
+            nx= probe_x(points[i+1].first) - X_PROBE_OFFSET_FROM_EXTRUDER;
+            ny= probe_y(points[i+1].second) - Y_PROBE_OFFSET_FROM_EXTRUDER;
         }
 
-        for (int xCount = xStart; xCount != xStop; xCount += xInc) {
-            float xProbe = LEFT_PROBE_BED_POSITION + AUTO_BED_LEVELING_GRID_X * xCount;
-
-            // Avoid probing the corners (outside the round or hexagon print surface) on a delta printer.
-            float distance_from_center = sqrtf(xProbe * xProbe + yProbe * yProbe);
-            if (distance_from_center > radius) continue;
-
-            if(!zprobe->doProbeAt(s, xProbe - X_PROBE_OFFSET_FROM_EXTRUDER, yProbe - Y_PROBE_OFFSET_FROM_EXTRUDER)) return false;
-            float measured_z = zprobe->getProbeHeight() - zprobe->zsteps_to_mm(s) - z_reference; // this is the delta z from bed at 0,0
-            gc->stream->printf("DEBUG: X%1.4f, Y%1.4f, Z%1.4f\n", xProbe, yProbe, measured_z);
-            grid[xCount + (grid_size * yCount)] = measured_z;
-        }
+        if(!zprobe->probe_and_move(s, nx, ny)) return false;
+        float measured_z = zprobe->getProbeHeight() - zprobe->zsteps_to_mm(s) - z_reference; // this is the delta z from bed at 0,0
+        gc->stream->printf("DEBUG: X%1.4f, Y%1.4f, Z%1.4f\n", xProbe, yProbe, measured_z);
+        grid->set(xCount, yCount, measured_z);
     }
 
     extrapolate_unprobed_bed_level();
@@ -474,12 +516,12 @@ bool DeltaGridStrategy::doProbe(Gcode *gc)
 
 void DeltaGridStrategy::extrapolate_one_point(int x, int y, int xdir, int ydir)
 {
-    if (!isnan(grid[x + (grid_size*y)])) {
+    if (!isnan(grid->get(x, y))) {
         return;  // Don't overwrite good values.
     }
-    float a = 2 * grid[(x + xdir) + (y*grid_size)] - grid[(x + xdir * 2) + (y*grid_size)]; // Left to right.
-    float b = 2 * grid[x + ((y + ydir) * grid_size)] - grid[x + ((y + ydir * 2) * grid_size)]; // Front to back.
-    float c = 2 * grid[(x + xdir) + ((y + ydir) * grid_size)] - grid[(x + xdir * 2) + ((y + ydir * 2) * grid_size)]; // Diagonal.
+    float a = 2 * grid->get(x + xdir, y) - grid->get(x + xdir * 2, y); // Left to right.
+    float b = 2 * grid->get(x, y + ydir) - grid->get(x, y + ydir * 2); // Front to back.
+    float c = 2 * grid->get(x + xdir, y + ydir) - grid->get(x + xdir * 2, y + ydir * 2); // Diagonal.
     float median = c;  // Median is robust (ignores outliers).
     if (a < b) {
         if (b < c) median = b;
@@ -488,7 +530,7 @@ void DeltaGridStrategy::extrapolate_one_point(int x, int y, int xdir, int ydir)
         if (c < b) median = b;
         if (a < c) median = a;
     }
-    grid[x + (grid_size*y)] = median;
+    grid->set(x, y, median);
 }
 
 // Fill in the unprobed points (corners of circular print surface)
@@ -509,41 +551,8 @@ void DeltaGridStrategy::extrapolate_unprobed_bed_level()
 
 void DeltaGridStrategy::doCompensation(float target[3])
 {
-    // Adjust print surface height by linear interpolation over the bed_level array.
-    int half = (grid_size - 1) / 2;
-    float grid_x = std::max(0.001F - half, std::min(half - 0.001F, target[X_AXIS] / AUTO_BED_LEVELING_GRID_X));
-    float grid_y = std::max(0.001F - half, std::min(half - 0.001F, target[Y_AXIS] / AUTO_BED_LEVELING_GRID_Y));
-    int floor_x = floorf(grid_x);
-    int floor_y = floorf(grid_y);
-    float ratio_x = grid_x - floor_x;
-    float ratio_y = grid_y - floor_y;
-    float z1 = grid[(floor_x + half) + ((floor_y + half) * grid_size)];
-    float z2 = grid[(floor_x + half) + ((floor_y + half + 1) * grid_size)];
-    float z3 = grid[(floor_x + half + 1) + ((floor_y + half) * grid_size)];
-    float z4 = grid[(floor_x + half + 1) + ((floor_y + half + 1) * grid_size)];
-    float left = (1 - ratio_y) * z1 + ratio_y * z2;
-    float right = (1 - ratio_y) * z3 + ratio_y * z4;
-    float offset = (1 - ratio_x) * left + ratio_x * right;
-
-    target[Z_AXIS] += offset;
-
-
-    /*
-        THEKERNEL->streams->printf("//DEBUG: TARGET: %f, %f, %f\n", target[0], target[1], target[2]);
-        THEKERNEL->streams->printf("//DEBUG: grid_x= %f\n", grid_x);
-        THEKERNEL->streams->printf("//DEBUG: grid_y= %f\n", grid_y);
-        THEKERNEL->streams->printf("//DEBUG: floor_x= %d\n", floor_x);
-        THEKERNEL->streams->printf("//DEBUG: floor_y= %d\n", floor_y);
-        THEKERNEL->streams->printf("//DEBUG: ratio_x= %f\n", ratio_x);
-        THEKERNEL->streams->printf("//DEBUG: ratio_y= %f\n", ratio_y);
-        THEKERNEL->streams->printf("//DEBUG: z1= %f\n", z1);
-        THEKERNEL->streams->printf("//DEBUG: z2= %f\n", z2);
-        THEKERNEL->streams->printf("//DEBUG: z3= %f\n", z3);
-        THEKERNEL->streams->printf("//DEBUG: z4= %f\n", z4);
-        THEKERNEL->streams->printf("//DEBUG: left= %f\n", left);
-        THEKERNEL->streams->printf("//DEBUG: right= %f\n", right);
-        THEKERNEL->streams->printf("//DEBUG: offset= %f\n", offset);
-    */
+    // Adjust print surface height by interpolating over the bed_level array, the edge value is held outside the grid
+    target[Z_AXIS] += grid->interpolate(target[X_AXIS], target[Y_AXIS]);
 }
 
 
@@ -552,7 +561,7 @@ void DeltaGridStrategy::print_bed_level(StreamOutput *stream)
 {
     for (int y = 0; y < grid_size; y++) {
         for (int x = 0; x < grid_size; x++) {
-            stream->printf("%7.4f ", grid[x + (grid_size*y)]);
+            stream->printf("%7.4f ", grid->get(x, y));
         }
         stream->printf("\n");
     }
@@ -561,9 +570,5 @@ void DeltaGridStrategy::print_bed_level(StreamOutput *stream)
 // Reset calibration results to zero.
 void DeltaGridStrategy::reset_bed_level()
 {
-    for (int y = 0; y < grid_size; y++) {
-        for (int x = 0; x < grid_size; x++) {
-            grid[x + (grid_size*y)] = NAN;
-        }
-    }
+    grid->fill(NAN);
 }
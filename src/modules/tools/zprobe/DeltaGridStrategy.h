@@ -9,6 +9,7 @@
 
 class StreamOutput;
 class Gcode;
+class BedMesh;
 
 class DeltaGridStrategy : public LevelingStrategy
 {
@@ -30,18 +31,20 @@ private:
     void reset_bed_level();
     void save_grid(StreamOutput *stream);
     bool load_grid(StreamOutput *stream);
+    bool load_legacy_grid(StreamOutput *stream);
     bool probe_spiral(int n, float radius, StreamOutput *stream);
     bool probe_grid(int n, float radius, StreamOutput *stream);
 
     float initial_height;
     float tolerance;
 
-    float *grid;
+    BedMesh *grid;
     float grid_radius;
     std::tuple<float, float, float> probe_offsets;
     uint8_t grid_size;
 
     struct {
         bool save:1;
+        bool bicubic:1;
     };
 };
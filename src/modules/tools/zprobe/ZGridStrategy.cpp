@@ -59,6 +59,10 @@
 
        leveling-strategy.ZGrid-leveling.slow_feedrate  100         # ZGrid probe positioning feedrate
 
+    The grid is interpolated bilinearly by default, a smoother Catmull-Rom bicubic surface can be used instead but needs four times the memory
+
+       leveling-strategy.ZGrid-leveling.bicubic  false
+
 
 
     Usage
@@ -73,7 +77,7 @@
     M372                 : move the head to the next calibration position after saving the current probe point to memory - manual calbration
     M373                 : completes calibration and enables the Z compensation grid
 
-    M374                 : Save the grid to "Zgrid" on SD card
+    M374                 : Save the grid to "Zgrid" on SD card, as a binary mesh file with a CRC (text grids from older versions still load)
     M374 S###            : Save custom grid to "Zgrid.###" on SD card
 
     M375                 : Loads grid file "Zgrid" from SD
@@ -103,6 +107,7 @@
 #include "platform_memory.h"
 #include "MemoryPool.h"
 #include "libs/utils.h"
+#include "BedMesh.h"
 
 #include <string>
 #include <algorithm>
@@ -126,6 +131,7 @@
 #define circular_bed_checksum        CHECKSUM("circular_bed")
 #define cal_offset_x_checksum        CHECKSUM("cal_offset_x")
 #define cal_offset_y_checksum        CHECKSUM("cal_offset_y")
+#define bicubic_checksum             CHECKSUM("bicubic")
 
 #define NOHOME                       0
 #define HOMEXY                       1
@@ -145,13 +151,13 @@ ZGridStrategy::ZGridStrategy(ZProbe *zprobe) : LevelingStrategy(zprobe)
     this->cal[Z_AXIS] = 30.0f;
 
     this->in_cal = false;
-    this->pData = nullptr;
+    this->mesh = nullptr;
 }
 
 ZGridStrategy::~ZGridStrategy()
 {
-    // Free program memory for the pData grid
-    if(this->pData != nullptr) AHB0.dealloc(this->pData);
+    // Free program memory for the grid
+    delete this->mesh;
 }
 
 bool ZGridStrategy::handleConfig()
@@ -169,6 +175,8 @@ bool ZGridStrategy::handleConfig()
     this->numRows = THEKERNEL->config->value(leveling_strategy_checksum, ZGrid_leveling_checksum, rows_checksum)->by_default(5)->as_number();
     this->numCols = THEKERNEL->config->value(leveling_strategy_checksum, ZGrid_leveling_checksum, cols_checksum)->by_default(5)->as_number();
 
+    this->bicubic = THEKERNEL->config->value(leveling_strategy_checksum, ZGrid_leveling_checksum, bicubic_checksum)->by_default(false)->as_bool();
+
     this->wait_for_probe   = THEKERNEL->config->value(leveling_strategy_checksum, ZGrid_leveling_checksum, wait_for_probe_checksum)->by_default(true)->as_bool();  // Morgan default = true
 
     std::string home_mode  = THEKERNEL->config->value(leveling_strategy_checksum, ZGrid_leveling_checksum, home_before_probe_checksum)->by_default("homexyz")->as_string();
@@ -195,11 +203,10 @@ bool ZGridStrategy::handleConfig()
     std::string po = THEKERNEL->config->value(leveling_strategy_checksum, ZGrid_leveling_checksum, probe_offsets_checksum)->by_default("0,0,0")->as_string();
     this->probe_offsets= parseXYZ(po.c_str());
 
+    this->mesh = new BedMesh(AHB0);
     this->calcConfig();                // Run calculations for Grid size and allocate initial grid memory
 
-    for (int i=0; i<(probe_points); i++){
-        this->pData[i] = 0.0F;        // Clear the grid
-    }
+    this->mesh->fill(0.0F);            // Clear the grid
 
     return true;
 }
@@ -209,11 +216,12 @@ void ZGridStrategy::calcConfig()
     this->bed_div_x = this->bed_x / float(this->numRows-1);    // Find divisors to calculate the calbration points
     this->bed_div_y = this->bed_y / float(this->numCols-1);
 
-    // Ensure free program memory for the pData grid
-    if(this->pData != nullptr) AHB0.dealloc(this->pData);
+    // Allocate program memory for the grid, this frees any previous one
+    this->mesh->allocate(this->numRows, this->numCols, this->bicubic);
 
-    // Allocate program memory for the pData grid
-    this->pData = (float *)AHB0.alloc(probe_points * sizeof(float));
+    // grid point 0,0 is at the calibration offset, moves outside the bed are extrapolated from the edge cells
+    this->mesh->set_bounds(this->cal_offset_x, this->cal_offset_y, this->cal_offset_x + this->bed_x, this->cal_offset_y + this->bed_y);
+    this->mesh->set_extrapolate(true);
 }
 
 bool ZGridStrategy::handleGcode(Gcode *gcode)
@@ -230,7 +238,7 @@ bool ZGridStrategy::handleGcode(Gcode *gcode)
                 for (int x=0; x<this->numRows; x++){
                     gcode->stream->printf("X%i",x);
                     for (int y=0; y<this->numCols; y++){
-                         gcode->stream->printf(" %c%1.2f", 'A'+y, this->pData[(x*this->numCols)+y]);
+                         gcode->stream->printf(" %c%1.2f", 'A'+y, this->mesh->get(x, y));
                     }
                     gcode->stream->printf("\r\n");
                 }
@@ -268,9 +276,7 @@ bool ZGridStrategy::handleGcode(Gcode *gcode)
                 this->calcConfig();                // Run calculations for Grid size and allocate grid memory
 
                 this->homexyz();
-                for (int i=0; i<probe_points; i++){
-                    this->pData[i] = 0.0F;        // Clear the ZGrid
-                }
+                this->mesh->fill(0.0F);        // Clear the ZGrid
 
                 this->cal[X_AXIS] = 0.0f;                                              // Clear calibration position
                 this->cal[Y_AXIS] = 0.0f;
@@ -291,16 +297,16 @@ bool ZGridStrategy::handleGcode(Gcode *gcode)
             case 372: {
                 if (in_cal){
                     float cartesian[3];
-                    int pindex = 0;
 
                     THEKERNEL->robot->get_axis_position(cartesian);         // get actual position from robot
 
-                    pindex = int(cartesian[X_AXIS]/this->bed_div_x + 0.25)*this->numCols + int(cartesian[Y_AXIS]/this->bed_div_y + 0.25);
+                    int xindex = int(cartesian[X_AXIS]/this->bed_div_x + 0.25);
+                    int yindex = int(cartesian[Y_AXIS]/this->bed_div_y + 0.25);
 
                     this->move(this->cal, slow_rate);                       // move to the next position
                     this->next_cal();                                       // to not cause damage to machine due to Z-offset
 
-                    this->pData[pindex] = cartesian[Z_AXIS];  // save the offset
+                    this->mesh->set(xindex, yindex, cartesian[Z_AXIS]);  // save the offset
 
                 }
             }
@@ -398,27 +404,38 @@ bool ZGridStrategy::handleGcode(Gcode *gcode)
 bool ZGridStrategy::saveGrid(std::string args)
 {
     args = "/sd/Zgrid." + args;
-    StreamOutput *ZMap_file = new FileStream(args.c_str());
 
-    ZMap_file->printf("P%i %i %i %1.3f\n", probe_points, this->numRows, this->numCols, getZhomeoffset());    // Store probe points to prevent loading undefined grid files
+    // the Z homing offset is kept with the grid
+    return this->mesh->save(args.c_str(), getZhomeoffset()) == nullptr;
+}
 
-    for (int pos = 0; pos < probe_points; pos++){
-        ZMap_file->printf("%1.3f\n", this->pData[pos]);
-    }
-    delete ZMap_file;
+bool ZGridStrategy::loadGrid(std::string args)
+{
+    args = "/sd/Zgrid." + args;
 
-    return true;
+    // grids saved before the binary mesh file are text
+    if(!BedMesh::is_mesh_file(args.c_str())) return loadTextGrid(args);
+
+    float GridZ;
+    if(this->mesh->load(args.c_str(), GridZ) != nullptr) return false;
+
+    this->numRows = this->mesh->get_nx();                       // Change Rows and Columns to match the saved data
+    this->numCols = this->mesh->get_ny();
+    this->bed_div_x = this->bed_x / float(this->numRows-1);
+    this->bed_div_y = this->bed_y / float(this->numCols-1);
+
+    this->setZoffset(GridZ);
 
+    return true;
 }
 
-bool ZGridStrategy::loadGrid(std::string args)
+bool ZGridStrategy::loadTextGrid(std::string args)
 {
     char flag[20];
 
     int fpoints, GridX = 5, GridY = 5;   // for 25point file
     float val, GridZ;
 
-    args = "/sd/Zgrid." + args;
     FILE *fd = fopen(args.c_str(), "r");
     if(fd != NULL) {
         fscanf(fd, "%s\n", flag);
@@ -440,11 +457,11 @@ bool ZGridStrategy::loadGrid(std::string args)
             this->calcConfig();                                     // Reallocate memory for the grid according to the grid loaded
         }
 
-        this->pData[0] = val;    // Place the first read value in grid
+        this->mesh->set(0, 0, val);    // Place the first read value in grid
 
         for (int pos = 1; pos < probe_points; pos++){
             fscanf(fd, "%f\n", &val);
-            this->pData[pos] = val;
+            this->mesh->set(pos / this->numCols, pos % this->numCols, val);
         }
 
         fclose(fd);
@@ -492,9 +509,7 @@ bool ZGridStrategy::doProbing(StreamOutput *stream)  // probed calibration
     // deactivate correction during moves
     this->setAdjustFunction(false);
 
-    for (int i=0; i<probe_points; i++){
-       this->pData[i] = 0.0F;        // Clear the ZGrid
-    }
+    this->mesh->fill(0.0F);        // Clear the ZGrid
 
     if (this->wait_for_probe){
 
@@ -517,19 +532,31 @@ bool ZGridStrategy::doProbing(StreamOutput *stream)  // probed calibration
     this->cal[Z_AXIS] = std::get<Z_AXIS>(this->probe_offsets) + zprobe->getProbeHeight();
 
     this->move(this->cal, slow_rate);            // Move to probe start point
+    zprobe->coordinated_move((this->cal[X_AXIS] + this->cal_offset_x)-std::get<X_AXIS>(this->probe_offsets),
+                             (this->cal[Y_AXIS] + this->cal_offset_y)-std::get<Y_AXIS>(this->probe_offsets), NAN, zprobe->getFastFeedrate());
 
     for (int probes = 0; probes < probe_points; probes++){
-        int pindex = 0;
+        int xindex = int(this->cal[X_AXIS]/this->bed_div_x + 0.25);
+        int yindex = int(this->cal[Y_AXIS]/this->bed_div_y + 0.25);
 
-        // z = z home offset - probed distance
-        float z = getZhomeoffset() -zprobe->probeDistance((this->cal[X_AXIS] + this->cal_offset_x)-std::get<X_AXIS>(this->probe_offsets),
-                                               (this->cal[Y_AXIS] + this->cal_offset_y)-std::get<Y_AXIS>(this->probe_offsets));
+        this->next_cal();                                        // Calculate next calibration position
 
-        pindex = int(this->cal[X_AXIS]/this->bed_div_x + 0.25)*this->numCols + int(this->cal[Y_AXIS]/this->bed_div_y + 0.25);
+        // probe here then lift and travel on to the next position in one go, next_cal() goes back to the start after the last one
+        float nx= NAN, ny= NAN;
+        if (probes+1 < probe_points) {
+            nx= (this->cal[X_AXIS] + this->cal_offset_x)-std::get<X_AXIS>(this->probe_offsets);
+            ny= (this->cal[Y_AXIS] + this->cal_offset_y)-std::get<Y_AXIS>(this->probe_offsets);
+        }
+        int s;
+        if (!zprobe->probe_and_move(s, nx, ny)) {
+            this->in_cal = false;
+            return false;
+        }
 
-        this->next_cal();                                        // Calculate next calibration position
+        // z = z home offset - probed distance
+        float z = getZhomeoffset() - zprobe->zsteps_to_mm(s);
 
-        this->pData[pindex] = z ;                                // save the offset
+        this->mesh->set(xindex, yindex, z);                      // save the offset
     }
 
     stream->printf("\nCalibration done.\n");
@@ -561,6 +588,8 @@ void ZGridStrategy::normalize_grid_2home()
 
     bool ok = PublicData::get_value( endstops_checksum, home_offset_checksum, &rd );
 
+    this->mesh->build();    // getZOffset needs the cell polynomials of the new grid
+
     if (ok) {
        home_Z_comp = this->getZOffset(((float*)rd)[0],((float*)rd)[1]);   // find the Z compensation at home position
     }
@@ -569,8 +598,7 @@ void ZGridStrategy::normalize_grid_2home()
     }
 
     // subtracts the home compensation offset to create a table of deltas, normalized to home compensation zero
-    for (int i = 0; i < probe_points; i++)
-        this->pData[i] -= home_Z_comp;
+    this->mesh->add(-home_Z_comp);
 
     // Doing this removes the need to change homing offset in Z because the reference remains unchanged.
 
@@ -645,11 +673,15 @@ void ZGridStrategy::next_cal(void){
 void ZGridStrategy::setAdjustFunction(bool on)
 {
     if(on) {
+        // work out the cell polynomials once here rather than on every move
+        this->mesh->build();
         // set the compensationTransform in robot
+        THEKERNEL->robot->compensation_mesh = this->mesh;
         THEKERNEL->robot->compensationTransform= [this](float target[3]) { target[2] += this->getZOffset(target[0], target[1]); };
     }else{
         // clear it
         THEKERNEL->robot->compensationTransform= nullptr;
+        THEKERNEL->robot->compensation_mesh = nullptr;
     }
 }
 
@@ -657,41 +689,7 @@ void ZGridStrategy::setAdjustFunction(bool on)
 // find the Z offset for the point on the plane at x, y
 float ZGridStrategy::getZOffset(float X, float Y)
 {
-    int xIndex2, yIndex2;
-
-    // Subtract calibration offsets as applicable
-    X -= this->cal_offset_x;
-    Y -= this->cal_offset_y;
-
-    float xdiff = X / this->bed_div_x;
-    float ydiff = Y / this->bed_div_y;
-
-    float dCartX1, dCartX2;
-
-    // Get floor of xdiff.  Note that (int) of a negative number is its
-    // ceiling, not its floor.
-
-    int xIndex = (int)(floorf(xdiff));	// Get the current sector (X)
-    int yIndex = (int)(floorf(ydiff));	// Get the current sector (Y)
-
-    // Index bounds limited to be inside the table
-    if (xIndex < 0) xIndex = 0;
-    else if (xIndex > (this->numRows - 2)) xIndex = this->numRows - 2;
-
-    if (yIndex < 0) yIndex = 0;
-    else if (yIndex > (this->numCols - 2)) yIndex = this->numCols - 2;
-
-    xIndex2 = xIndex+1;
-    yIndex2 = yIndex+1;
-
-    xdiff -= xIndex;                    // Find floating point
-    ydiff -= yIndex;                    // Find floating point
-
-    dCartX1 = (1-xdiff) * this->pData[(xIndex*this->numCols)+yIndex] + (xdiff) * this->pData[(xIndex2)*this->numCols+yIndex];
-    dCartX2 = (1-xdiff) * this->pData[(xIndex*this->numCols)+yIndex2] + (xdiff) * this->pData[(xIndex2)*this->numCols+yIndex2];
-
-    return ydiff * dCartX2 + (1-ydiff) * dCartX1;    // Calculated Z-delta
-
+    return this->mesh->interpolate(X, Y);    // Calculated Z-delta
 }
 
 // parse a "X,Y,Z" string return x,y,z tuple
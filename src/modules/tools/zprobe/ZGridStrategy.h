@@ -10,6 +10,7 @@
 #define ZGrid_leveling_checksum CHECKSUM("ZGrid-leveling")
 
 class StreamOutput;
+class BedMesh;
 
 class ZGridStrategy : public LevelingStrategy
 {
@@ -33,6 +34,7 @@ private:
     void normalize_grid_2home();
 
     bool loadGrid(std::string args);
+    bool loadTextGrid(std::string args);
     bool saveGrid(std::string args);
     void calcConfig();
 
@@ -41,7 +43,7 @@ private:
 
     uint16_t numRows;
     uint16_t numCols;
-    float *pData;
+    BedMesh *mesh;
     float slow_rate;
     float bed_x;
     float bed_y;
@@ -60,6 +62,7 @@ private:
         bool center_zero:1;
         bool circular_bed:1;
         bool wait_for_probe:1;
+        bool bicubic:1;
     };
 };
 
@@ -27,6 +27,7 @@
 #include "LevelingStrategy.h"
 #include "StepTicker.h"
 #include "utils.h"
+#include "InterruptIn.h" // mbed
 
 // strategies we know about
 #include "DeltaCalibrationStrategy.h"
@@ -84,6 +85,16 @@ void ZProbe::on_config_reload(void *argument)
     this->pin.from_string( THEKERNEL->config->value(zprobe_checksum, probe_pin_checksum)->by_default("nc" )->as_string())->as_input();
     this->debounce_count = THEKERNEL->config->value(zprobe_checksum, debounce_count_checksum)->by_default(0  )->as_number();
 
+    // if the probe is on an interrupt capable pin (ports 0 and 2) the trigger position is latched by the edge interrupt
+    if(this->probe_irq == nullptr) {
+        Pin dummy_pin= this->pin;
+        this->probe_irq= dummy_pin.interrupt_pin();
+        if(this->probe_irq != nullptr) {
+            if(this->pin.is_inverting()) this->probe_irq->fall(this, &ZProbe::on_pin_edge);
+            else this->probe_irq->rise(this, &ZProbe::on_pin_edge);
+        }
+    }
+
     // get strategies to load
     vector<uint16_t> modules;
     THEKERNEL->config->get_module_list( &modules, leveling_strategy_checksum);
@@ -150,11 +161,33 @@ bool ZProbe::wait_for_probe(int& steps)
 
         bool delta= is_delta || is_rdelta;
 
+        if(this->latch.is_latched()) {
+            // the interrupt has the position, but check the pin stays on for as long as polling would have before trusting it
+            if(debounce < debounce_count) {
+                if(this->pin.get()) {
+                    debounce++;
+                } else {
+                    // it was noise, wait for the next edge
+                    debounce = 0;
+                    this->latch.rearm();
+                    latch_if_active();
+                }
+                continue;
+            }
+            return finish_latched_probe(steps);
+        }
+
         // if no stepper is moving, moves are finished and there was no touch
         if( !STEPPER[Z_AXIS]->is_moving() && (!delta || (!STEPPER[Y_AXIS]->is_moving() && !STEPPER[Z_AXIS]->is_moving())) ) {
             return false;
         }
 
+        // the interrupt will catch the trigger, but keep polling in case the edge came before it was armed or was missed
+        if(this->latch.is_armed()) {
+            latch_if_active();
+            continue;
+        }
+
         // if the probe is active...
         if( this->pin.get() ) {
             //...increase debounce counter...
@@ -183,6 +216,53 @@ bool ZProbe::wait_for_probe(int& steps)
     }
 }
 
+// called on the edge of the probe pin going active, snapshots the actuator positions
+void ZProbe::on_pin_edge()
+{
+    // nothing to debounce so start slowing down now, the position has already been latched so there is no hurry
+    if(this->latch.capture() && this->debounce_count == 0) this->current_feedrate = 0;
+}
+
+// there is no edge to interrupt on if the pin is already active, so latch it from here, with the step interrupt held
+// off for the snapshot as it would be in the pin interrupt
+void ZProbe::latch_if_active()
+{
+    __disable_irq();
+    if(this->latch.is_armed() && this->pin.get()) on_pin_edge();
+    __enable_irq();
+}
+
+// the probe position was latched by the interrupt, let the actuators ramp down to a stop then step them back to
+// where it triggered, so the head is left exactly where it would have been had it stopped dead
+bool ZProbe::finish_latched_probe(int& steps)
+{
+    this->current_feedrate = 0;
+    while(STEPPER[X_AXIS]->is_moving() || STEPPER[Y_AXIS]->is_moving() || STEPPER[Z_AXIS]->is_moving()) {
+        THEKERNEL->call_event(ON_IDLE);
+        if(THEKERNEL->is_halted()) return false;
+    }
+
+    bool moving= false;
+    for ( int c = X_AXIS; c <= Z_AXIS; c++ ) {
+        int32_t o= this->latch.overrun(c);
+        if(o != 0) {
+            STEPPER[c]->move(o > 0, abs(o), 0);
+            moving= true;
+        }
+    }
+
+    if(moving) {
+        this->current_feedrate = this->slow_feedrate * Z_STEPS_PER_MM;
+        while(STEPPER[X_AXIS]->is_moving() || STEPPER[Y_AXIS]->is_moving() || STEPPER[Z_AXIS]->is_moving()) {
+            THEKERNEL->call_event(ON_IDLE);
+            if(THEKERNEL->is_halted()) return false;
+        }
+    }
+
+    steps= abs(this->latch.moved(Z_AXIS));
+    return true;
+}
+
 // single probe with custom feedrate
 // returns boolean value indicating if probe was triggered
 bool ZProbe::run_probe(int& steps, float feedrate, float max_dist, bool reverse)
@@ -206,11 +286,31 @@ bool ZProbe::run_probe(int& steps, float feedrate, float max_dist, bool reverse)
         STEPPER[Y_AXIS]->move(dir, maxz * STEPS_PER_MM(Y_AXIS), 0);
     }
 
+    // latch the trigger position from the pin interrupt, which runs at the step timer's priority for the duration so
+    // the snapshot of the step counters can't be split by a step
+    uint32_t irq_priority= 0;
+    if(this->probe_irq != nullptr) {
+        const volatile int32_t *counters[3]= {
+            STEPPER[X_AXIS]->get_position_counter(),
+            STEPPER[Y_AXIS]->get_position_counter(),
+            STEPPER[Z_AXIS]->get_position_counter()
+        };
+        irq_priority= NVIC_GetPriority(EINT3_IRQn);
+        NVIC_SetPriority(EINT3_IRQn, NVIC_GetPriority(TIMER0_IRQn));
+        this->latch.arm(counters, 3);
+        // already triggered, the move stops straight away
+        latch_if_active();
+    }
+
     // start acceleration processing
     this->running = true;
 
     bool r = wait_for_probe(steps);
     this->running = false;
+    if(this->probe_irq != nullptr) {
+        this->latch.disarm();
+        NVIC_SetPriority(EINT3_IRQn, irq_priority);
+    }
     STEPPER[X_AXIS]->move(0, 0);
     STEPPER[Y_AXIS]->move(0, 0);
     STEPPER[Z_AXIS]->move(0, 0);
@@ -274,6 +374,28 @@ bool ZProbe::doProbeAt(int &steps, float x, float y)
     return true;
 }
 
+// probe down from where the head is now, then lift back to the starting height and travel on to x,y in machine
+// coordinates (NAN to only lift). The lift and the travel are queued together so the planner blends them at the corner,
+// rather than returning the probe and then starting the travel from rest. Compensation must be off as the position is
+// picked up again from the actuators
+bool ZProbe::probe_and_move(int &steps, float x, float y)
+{
+    float start[3];
+    THEKERNEL->robot->get_axis_position(start);
+
+    int s;
+    if(!run_probe(s)) return false;
+    steps = s;
+
+    // the probe moved the actuators without telling the robot, so start the lift from where they actually stopped
+    THEKERNEL->robot->reset_position_from_current_actuator_position();
+    coordinated_move(NAN, NAN, start[Z_AXIS], getFastFeedrate(), false, false);
+    if(!isnan(x) || !isnan(y)) coordinated_move(x, y, NAN, getFastFeedrate(), false, false);
+    THEKERNEL->conveyor->wait_for_empty_queue();
+
+    return true;
+}
+
 float ZProbe::probeDistance(float x, float y)
 {
     int s;
@@ -538,22 +660,31 @@ void ZProbe::accelerate(int c)
 
     // Z may have a different acceleration to X and Y
     float acc= (c==Z_AXIS) ? THEKERNEL->planner->get_z_acceleration() : THEKERNEL->planner->get_acceleration();
+    uint32_t rate_change = floorf((acc / THEKERNEL->acceleration_ticks_per_second) * STEPS_PER_MM(c));
     if( current_rate < target_rate ) {
-        uint32_t rate_increase = floorf((acc / THEKERNEL->acceleration_ticks_per_second) * STEPS_PER_MM(c));
-        current_rate = min( target_rate, current_rate + rate_increase );
+        current_rate = min( target_rate, current_rate + rate_change );
     }
     if( current_rate > target_rate ) {
-        current_rate = target_rate;
+        if(target_rate == 0) {
+            // a latched probe has triggered so ramp down to a stop
+            if(current_rate <= rate_change + STEPPER[c]->get_min_rate()) {
+                STEPPER[c]->force_finish_move();
+                return;
+            }
+            current_rate -= rate_change;
+        } else {
+            current_rate = target_rate;
+        }
     }
 
     // steps per second
     STEPPER[c]->set_speed(current_rate);
 }
 
-// issue a coordinated move directly to robot, and return when done
+// issue a coordinated move directly to robot, and return when done unless wait is false, in which case it is left queued
 // Only move the coordinates that are passed in as not nan
 // NOTE must use G53 to force move in machine coordiantes and ignore any WCS offsetts
-void ZProbe::coordinated_move(float x, float y, float z, float feedrate, bool relative)
+void ZProbe::coordinated_move(float x, float y, float z, float feedrate, bool relative, bool wait)
 {
     char buf[32];
     char cmd[64];
@@ -586,7 +717,7 @@ void ZProbe::coordinated_move(float x, float y, float z, float feedrate, bool re
     message.message = cmd;
     message.stream = &(StreamOutput::NullStream);
     THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message );
-    THEKERNEL->conveyor->wait_for_empty_queue();
+    if(wait) THEKERNEL->conveyor->wait_for_empty_queue();
 }
 
 // issue home command
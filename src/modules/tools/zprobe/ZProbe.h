@@ -10,6 +10,7 @@
 
 #include "Module.h"
 #include "Pin.h"
+#include "ProbeLatch.h"
 
 #include <vector>
 
@@ -22,11 +23,15 @@ class Gcode;
 class StreamOutput;
 class LevelingStrategy;
 
+namespace mbed {
+    class InterruptIn;
+}
+
 class ZProbe: public Module
 {
 
 public:
-    ZProbe() : running(false), invert_override(false) {};
+    ZProbe() : probe_irq(nullptr), running(false), invert_override(false) {};
     virtual ~ZProbe() {};
 
     void on_module_loaded();
@@ -38,9 +43,10 @@ public:
     bool run_probe(int& steps, bool fast= false) { return run_probe(steps, fast ? this->fast_feedrate : this->slow_feedrate); }
     bool return_probe(int steps, bool reverse= false);
     bool doProbeAt(int &steps, float x, float y);
+    bool probe_and_move(int &steps, float x, float y);
     float probeDistance(float x, float y);
 
-    void coordinated_move(float x, float y, float z, float feedrate, bool relative=false);
+    void coordinated_move(float x, float y, float z, float feedrate, bool relative=false, bool wait=true);
     void home();
 
     bool getProbeStatus() { return this->pin.get(); }
@@ -53,6 +59,9 @@ public:
 private:
     void on_config_reload(void *argument);
     void accelerate(int c);
+    void on_pin_edge();
+    void latch_if_active();
+    bool finish_latched_probe(int& steps);
     void probe_XYZ(Gcode *gc, int axis);
     uint32_t read_probe(uint32_t dummy);
     volatile float current_feedrate;
@@ -63,6 +72,8 @@ private:
     float max_z;
 
     Pin pin;
+    mbed::InterruptIn *probe_irq; // set when the probe pin can interrupt, and the trigger position is latched by it
+    ProbeLatch latch;
     std::vector<LevelingStrategy*> strategies;
     uint8_t debounce_count;
 
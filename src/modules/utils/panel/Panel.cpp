@@ -73,6 +73,8 @@ Panel::Panel()
     this->counter_changed = false;
     this->click_changed = false;
     this->refresh_flag = false;
+    this->scanned_buttons = false;
+    this->last_button_check = 0;
     this->enter_menu_mode();
     this->lcd = NULL;
     this->do_buttons = false;
@@ -175,7 +177,13 @@ void Panel::on_module_loaded()
 //    this->pause_button.set_longpress_delay(longpress_delay);
 
 
-    THEKERNEL->slow_ticker->attach( 50,  this, &Panel::button_tick );
+    if(lcd->scanButtons()) {
+        // the input scanner reads and debounces the buttons, on_idle() checks their state as often as button_tick did
+        this->scanned_buttons = true;
+        this->last_button_check = us_ticker_read();
+    } else {
+        THEKERNEL->slow_ticker->attach( 50,  this, &Panel::button_tick );
+    }
     if(lcd->encoderReturnsDelta()) {
         // panel handles encoder pins and returns a delta
         THEKERNEL->slow_ticker->attach( 10, this, &Panel::encoder_tick );
@@ -350,10 +358,21 @@ void Panel::on_idle(void *argument)
         encoder_check(0);
     }
 
-    if (this->do_buttons) {
+    bool read_buttons = false;
+    if (this->scanned_buttons) {
+        // the buttons debounce by counting checks, so keep them at 50Hz
+        uint32_t now = us_ticker_read();
+        if (now - this->last_button_check >= 1000000 / 50) {
+            this->last_button_check = now;
+            read_buttons = true;
+        }
+    } else if (this->do_buttons) {
         // we don't want to do SPI in interrupt mode
         this->do_buttons = false;
+        read_buttons = true;
+    }
 
+    if (read_buttons) {
         // read the actual buttons
         int but = lcd->readButtons();
         if (but != 0) {
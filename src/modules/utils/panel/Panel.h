@@ -133,6 +133,10 @@ class Panel : public Module {
         char playing_file[20];
         uint8_t extsd_spi_channel;
 
+        // the lcd's buttons are read by the input scanner rather than polled from button_tick()
+        bool scanned_buttons;
+        uint32_t last_button_check;
+
         volatile struct {
             bool start_up:1;
             bool menu_changed:1;
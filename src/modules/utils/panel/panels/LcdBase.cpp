@@ -1,5 +1,9 @@
 #include "LcdBase.h"
 
+#include "Kernel.h"
+#include "InputScanner.h"
+#include "Pin.h"
+
 #include "stdarg.h"
 #include "stdio.h"
 
@@ -15,3 +19,8 @@ int LcdBase::printf(const char* format, ...){
     this->write(buffer, n);
     return n;
 }
+
+bool LcdBase::getButton(Pin &pin, int input)
+{
+    return input >= 0 ? THEKERNEL->input_scanner->get(input) : pin.get();
+}
@@ -20,6 +20,7 @@
 #define LED_HOT       4
 
 class Panel;
+class Pin;
 
 class LcdBase {
     public:
@@ -54,6 +55,9 @@ class LcdBase {
         virtual void buzz(long,uint16_t){};
         virtual bool hasGraphics() { return false; }
         virtual bool encoderReturnsDelta() { return false; } // set to true if the panel handles encoder clicks and returns a delta
+        // panels with their buttons on GPIO pins give them to the input scanner and return true, readButtons() then
+        // returns their debounced state and the panel no longer needs a ticker to read them
+        virtual bool scanButtons() { return false; }
         virtual uint8_t getContrast() { return 0; }
         virtual void setContrast(uint8_t c) { }
 
@@ -72,6 +76,8 @@ class LcdBase {
     protected:
         Panel* panel;
         virtual void write(const char* line, int len)= 0;
+        // the debounced state of a button given to the input scanner, or the pin itself if it was not
+        static bool getButton(Pin &pin, int input);
 
 };
 
@@ -7,6 +7,7 @@
 #include "ReprapDiscountGLCD.h"
 
 #include "Kernel.h"
+#include "InputScanner.h"
 #include "checksumm.h"
 #include "libs/Config.h"
 #include "rrdglcd/RrdGlcd.h"
@@ -33,6 +34,7 @@ ReprapDiscountGLCD::ReprapDiscountGLCD() {
     this->back_pin.from_string(THEKERNEL->config->value( panel_checksum, back_button_pin_checksum)->by_default("nc")->as_string())->as_input();
     this->buzz_pin.from_string(THEKERNEL->config->value( panel_checksum, buzz_pin_checksum)->by_default("nc")->as_string())->as_output();
     this->spi_cs_pin.from_string(THEKERNEL->config->value( panel_checksum, spi_cs_pin_checksum)->by_default("nc")->as_string())->as_output();
+    this->click_input= this->pause_input= this->back_input= -1;
 
     // select which SPI channel to use
     int spi_channel = THEKERNEL->config->value(panel_checksum, spi_channel_checksum)->by_default(0)->as_number();
@@ -48,13 +50,21 @@ ReprapDiscountGLCD::~ReprapDiscountGLCD() {
 
 uint8_t ReprapDiscountGLCD::readButtons() {
     uint8_t state= 0;
-    state |= (this->click_pin.get() ? BUTTON_SELECT : 0);
+    state |= (getButton(this->click_pin, this->click_input) ? BUTTON_SELECT : 0);
     // check the pause button
-    if(this->pause_pin.connected() && this->pause_pin.get()) state |= BUTTON_PAUSE;
-    if(this->back_pin.connected() && this->back_pin.get()) state |= BUTTON_LEFT;
+    if(this->pause_pin.connected() && getButton(this->pause_pin, this->pause_input)) state |= BUTTON_PAUSE;
+    if(this->back_pin.connected() && getButton(this->back_pin, this->back_input)) state |= BUTTON_LEFT;
     return state;
 }
 
+// the buttons are all on GPIO pins
+bool ReprapDiscountGLCD::scanButtons() {
+    this->click_input= THEKERNEL->input_scanner->attach(this->click_pin);
+    this->pause_input= THEKERNEL->input_scanner->attach(this->pause_pin);
+    this->back_input= THEKERNEL->input_scanner->attach(this->back_pin);
+    return true;
+}
+
 int ReprapDiscountGLCD::readEncoderDelta() {
     static const int8_t enc_states[] = {0,-1,1,0,1,0,0,-1,-1,0,0,1,0,1,-1,0};
     static uint8_t old_AB = 0;
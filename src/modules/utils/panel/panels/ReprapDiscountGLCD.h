@@ -22,6 +22,7 @@ class ReprapDiscountGLCD : public LcdBase {
         uint16_t get_screen_lines() { return 8; }
 
         uint8_t readButtons();
+        bool scanButtons();
         int readEncoderDelta();
         void write(const char* line, int len);
         void home();
@@ -48,6 +49,11 @@ class ReprapDiscountGLCD : public LcdBase {
         Pin pause_pin;
         Pin back_pin;
         Pin buzz_pin;
+
+        // input scanner ids of the buttons
+        int click_input;
+        int pause_input;
+        int back_input;
 };
 
 
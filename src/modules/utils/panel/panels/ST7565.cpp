@@ -8,6 +8,7 @@
 #include "ST7565.h"
 #include "ST7565/glcdfont.h"
 #include "Kernel.h"
+#include "InputScanner.h"
 #include "platform_memory.h"
 #include "Config.h"
 #include "checksumm.h"
@@ -128,6 +129,7 @@ ST7565::ST7565(uint8_t variant)
     this->click_pin.from_string(THEKERNEL->config->value( panel_checksum, click_button_pin_checksum )->by_default("nc")->as_string())->as_input();
     this->encoder_a_pin.from_string(THEKERNEL->config->value( panel_checksum, encoder_a_pin_checksum)->by_default("nc")->as_string())->as_input();
     this->encoder_b_pin.from_string(THEKERNEL->config->value( panel_checksum, encoder_b_pin_checksum)->by_default("nc")->as_string())->as_input();
+    this->click_input= this->up_input= this->down_input= this->aux_input= -1;
 
     this->buzz_pin.from_string(THEKERNEL->config->value( panel_checksum, buzz_pin_checksum)->by_default("nc")->as_string())->as_output();
 
@@ -320,12 +322,12 @@ void ST7565::on_refresh(bool now)
 uint8_t ST7565::readButtons(void)
 {
     uint8_t state = 0;
-    state |= (this->click_pin.get() ? BUTTON_SELECT : 0);
+    state |= (getButton(this->click_pin, this->click_input) ? BUTTON_SELECT : 0);
     if(this->up_pin.connected()) {
-        state |= (this->up_pin.get() ? BUTTON_UP : 0);
-        state |= (this->down_pin.get() ? BUTTON_DOWN : 0);
+        state |= (getButton(this->up_pin, this->up_input) ? BUTTON_UP : 0);
+        state |= (getButton(this->down_pin, this->down_input) ? BUTTON_DOWN : 0);
     }
-    if(this->aux_pin.connected() && this->aux_pin.get()) {
+    if(this->aux_pin.connected() && getButton(this->aux_pin, this->aux_input)) {
         if(this->use_pause) state |= BUTTON_PAUSE;
         else if(this->use_back) state |= BUTTON_LEFT;
     }
@@ -333,6 +335,16 @@ uint8_t ST7565::readButtons(void)
     return state;
 }
 
+// the buttons are all on GPIO pins
+bool ST7565::scanButtons()
+{
+    this->click_input = THEKERNEL->input_scanner->attach(this->click_pin);
+    this->up_input = THEKERNEL->input_scanner->attach(this->up_pin);
+    this->down_input = THEKERNEL->input_scanner->attach(this->down_pin);
+    this->aux_input = THEKERNEL->input_scanner->attach(this->aux_pin);
+    return true;
+}
+
 int ST7565::readEncoderDelta()
 {
     static int8_t enc_states[] = {0, -1, 1, 0, 1, 0, 0, -1, -1, 0, 0, 1, 0, 1, -1, 0};
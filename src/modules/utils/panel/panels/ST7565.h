@@ -27,6 +27,7 @@ public:
 	void on_refresh(bool now=false);
 	//encoder which dosent exist :/
 	uint8_t readButtons();
+	bool scanButtons();
 	int readEncoderDelta();
 	int getEncoderResolution() { return is_viki2 ? 4 : 2; }
 	uint16_t get_screen_lines() { return 8; }
@@ -72,6 +73,12 @@ private:
     Pin red_led;
     Pin blue_led;
 
+    // input scanner ids of the buttons
+    int click_input;
+    int up_input;
+    int down_input;
+    int aux_input;
+
 	// text cursor position
 	uint8_t tx, ty;
     uint8_t contrast;
@@ -15,6 +15,8 @@
 #include "libs/utils.h"
 #include <string>
 #include "Robot.h"
+#include "Gcode.h"
+#include "StreamOutput.h"
 #include "PublicData.h"
 #include "checksumm.h"
 #include "LcdBase.h"
@@ -125,9 +127,9 @@ void ControlScreen::enter_menu_control()
 
 void ControlScreen::set_current_pos(char axis, float p)
 {
-    // change pos by issuing a G0 Xnnn
+    // change pos by jogging to Xnnn, only a short distance gets queued so it stops soon after the knob does
     char buf[32];
-    int n = snprintf(buf, sizeof(buf), "G0 %c%f F%d", axis, p, (int)round(THEPANEL->get_jogging_speed(axis)));
-    string g(buf, n);
-    send_gcode(g);
+    int n = snprintf(buf, sizeof(buf), "G90 %c%f F%d", axis, p, (int)round(THEPANEL->get_jogging_speed(axis)));
+    Gcode gcode(string(buf, n), &(StreamOutput::NullStream));
+    THEKERNEL->robot->jog(&gcode);
 }
@@ -28,6 +28,7 @@
 #include "BaseSolution.h"
 #include "StepperMotor.h"
 #include "Configurator.h"
+#include "IsrProfiler.h"
 
 #include "TemperatureControlPublicAccess.h"
 #include "EndstopsPublicAccess.h"
@@ -50,6 +51,7 @@ extern unsigned int g_maximumHeapAddress;
 #include <mri.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <algorithm>
 
 extern "C" uint32_t  __end__;
 extern "C" uint32_t  __malloc_free_list;
@@ -81,6 +83,12 @@ const SimpleShell::ptentry_t SimpleShell::commands_table[] = {
     {"calc_thermistor", SimpleShell::calc_thermistor_command},
     {"thermistors", SimpleShell::print_thermistors_command},
     {"md5sum",   SimpleShell::md5sum_command},
+#ifdef ISR_PROFILE
+    {"isrprofile", SimpleShell::isrprofile_command},
+#endif
+#ifdef EVENT_PROFILE
+    {"top",      SimpleShell::top_command},
+#endif
 
     // unknown command
     {NULL, NULL}
@@ -248,6 +256,20 @@ void SimpleShell::on_console_line_received( void *argument )
                 }
                 break;
 
+            case 'J':
+                // grbl style jog $J=G91 X10 F1000, can be cancelled with the jog cancel realtime command
+                if(possible_command.size() > 3 && possible_command[2] == '=') {
+                    Gcode gcode(possible_command.substr(3), new_message.stream);
+                    if(THEKERNEL->robot->jog(&gcode)) {
+                        new_message.stream->printf("ok\n");
+                    }else{
+                        new_message.stream->printf("error:%s\n", gcode.txt_after_ok.c_str());
+                    }
+                }else{
+                    new_message.stream->printf("error:Invalid jog command\n");
+                }
+                break;
+
             default:
                 new_message.stream->printf("error:Invalid statement\n");
                 break;
@@ -796,6 +818,19 @@ void SimpleShell::get_command( string parameters, StreamOutput *stream)
         THEKERNEL->robot->print_position(4, buf, sizeof buf); stream->printf("%s\n", buf);
         THEKERNEL->robot->print_position(5, buf, sizeof buf); stream->printf("%s\n", buf);
 
+    } else if (what == "queue") {
+        // how well the block queue has been kept fed since the last get queue -r
+        QueueStats &qs= THEKERNEL->conveyor->get_queue_stats();
+        if(shift_parameter( parameters ) == "-r") {
+            qs.reset();
+            stream->printf("queue stats reset\n");
+            return;
+        }
+        stream->printf("queued: %u, ", THEKERNEL->conveyor->queued_blocks());
+        if(qs.has_min_depth()) stream->printf("min depth: %lu, ", qs.get_min_depth());
+        else stream->printf("min depth: -, ");
+        stream->printf("underruns: %lu, total %1.3f s, longest %1.3f s\n", qs.get_underruns(), qs.get_underrun_us() / 1e6F, qs.get_longest_underrun_us() / 1e6F);
+
     } else if (what == "wcs") {
         // print the wcs state
         grblDP_command("-v", stream);
@@ -920,6 +955,98 @@ void SimpleShell::md5sum_command( string parameters, StreamOutput *stream )
     fclose(lp);
 }
 
+#ifdef ISR_PROFILE
+// print how long each of the profiled interrupts has taken since the last reset, and the spread in powers of two
+void SimpleShell::isrprofile_command( string parameters, StreamOutput *stream )
+{
+    IsrProfiler &profiler= IsrProfiler::instance;
+    if(shift_parameter(parameters) == "-r") {
+        profiler.reset();
+        stream->printf("isr profile reset\r\n");
+        return;
+    }
+
+    float us= 1000000.0F / SystemCoreClock;
+    stream->printf("cycles (us)    count          min          mean           max\r\n");
+    for (int i = 0; i < IsrProfiler::NUM_ISRS; ++i) {
+        // copy it so the numbers printed agree with each other
+        __disable_irq();
+        IsrProfiler::stats_t s= profiler.get(i);
+        __enable_irq();
+
+        if(s.reset || s.count == 0) {
+            stream->printf("%-8s %10d\r\n", IsrProfiler::name(i), 0);
+            continue;
+        }
+        uint32_t mean= s.total / s.count;
+        stream->printf("%-8s %10lu %6lu (%4.1f) %6lu (%4.1f) %6lu (%4.1f)\r\n", IsrProfiler::name(i), s.count,
+                       s.min, s.min * us, mean, mean * us, s.max, s.max * us);
+
+        stream->printf("  ");
+        for (int b = 0; b < IsrProfiler::buckets; ++b) {
+            if(s.histogram[b] == 0) continue;
+            if(b == IsrProfiler::buckets - 1) stream->printf(" >=%lu:%lu", 1UL << (b - 1), s.histogram[b]);
+            else stream->printf(" <%lu:%lu", 1UL << b, s.histogram[b]);
+        }
+        stream->printf("\r\n");
+    }
+}
+#endif
+
+#ifdef EVENT_PROFILE
+// print the event handlers that have taken the most time since the last reset. Handlers are shown by address, look them
+// up with arm-none-eabi-addr2line -C -f -e main.elf <address>
+void SimpleShell::top_command( string parameters, StreamOutput *stream )
+{
+    static const char *const event_names[NUMBER_OF_DEFINED_EVENTS]= {
+        "main_loop", "console_line", "gcode_received", "gcode_execute", "block_begin", "block_end",
+        "idle", "second_tick", "get_public_data", "set_public_data", "halt", "enable"
+    };
+
+    int count= 15;
+    while(!parameters.empty()) {
+        string s= shift_parameter(parameters);
+        if(s == "-r") {
+            THEKERNEL->reset_event_times();
+            stream->printf("event times reset\r\n");
+            return;
+        }
+        count= strtol(s.c_str(), nullptr, 10);
+    }
+
+    struct entry_t {
+        uint8_t event;
+        uint8_t hook;
+        Kernel::event_time_t time;
+    };
+    std::vector<entry_t> entries;
+    for (int e = 0; e < NUMBER_OF_DEFINED_EVENTS; ++e) {
+        const auto &times= THEKERNEL->get_event_times((_EVENT_ENUM)e);
+        for (size_t i = 0; i < times.size(); ++i) {
+            if(times[i].calls > 0) entries.push_back({(uint8_t)e, (uint8_t)i, times[i]});
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const entry_t &a, const entry_t &b) { return a.time.total > b.time.total; });
+
+    float elapsed= (us_ticker_read() - THEKERNEL->get_event_times_start()) / 1000000.0F;
+    float us= 1000000.0F / SystemCoreClock;
+    stream->printf("%1.1f seconds\r\n %%time  total ms     calls  mean us   max us  event            handler\r\n", elapsed);
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpmf-conversions"
+    for (int n = 0; n < count && n < (int)entries.size(); ++n) {
+        const entry_t &en= entries[n];
+        Module *m= THEKERNEL->get_hooks((_EVENT_ENUM)en.event)[en.hook];
+        // the address of the handler the module overrides
+        void *handler= (void *)(void (*)(Module *, void *))(m->*kernel_callback_functions[en.event]);
+        float total_ms= en.time.total * us / 1000.0F;
+        stream->printf("%6.2f %9.1f %9lu %8.1f %8.1f  %-16s %p\r\n", elapsed > 0 ? total_ms / 10.0F / elapsed : 0, total_ms,
+                       en.time.calls, en.time.total * us / en.time.calls, en.time.max * us, event_names[en.event], handler);
+    }
+#pragma GCC diagnostic pop
+}
+#endif
+
 
 
 void SimpleShell::help_command( string parameters, StreamOutput *stream )
@@ -942,7 +1069,7 @@ void SimpleShell::help_command( string parameters, StreamOutput *stream )
     stream->printf("break - break into debugger\r\n");
     stream->printf("config-get [<configuration_source>] <configuration_setting>\r\n");
     stream->printf("config-set [<configuration_source>] <configuration_setting> <value>\r\n");
-    stream->printf("get [pos|wcs|state|status|fk|ik]\r\n");
+    stream->printf("get [pos|wcs|state|status|fk|ik|queue]\r\n");
     stream->printf("get temp [bed|hotend]\r\n");
     stream->printf("set_temp bed|hotend 185\r\n");
     stream->printf("net\r\n");
@@ -952,5 +1079,11 @@ void SimpleShell::help_command( string parameters, StreamOutput *stream )
     stream->printf("calc_thermistor [-s0] T1,R1,T2,R2,T3,R3 - calculate the Steinhart Hart coefficients for a thermistor\r\n");
     stream->printf("thermistors - print out the predefined thermistors\r\n");
     stream->printf("md5sum file - prints md5 sum of the given file\r\n");
+#ifdef ISR_PROFILE
+    stream->printf("isrprofile [-r] - prints the interrupt timings, -r resets them\r\n");
+#endif
+#ifdef EVENT_PROFILE
+    stream->printf("top [-r] [count] - prints the module event handlers that took the most time, -r resets them\r\n");
+#endif
 }
 
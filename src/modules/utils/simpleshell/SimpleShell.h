@@ -60,6 +60,12 @@ private:
 
     static void remount_command( string parameters, StreamOutput *stream);
 
+#ifdef ISR_PROFILE
+    static void isrprofile_command( string parameters, StreamOutput *stream);
+#endif
+#ifdef EVENT_PROFILE
+    static void top_command( string parameters, StreamOutput *stream);
+#endif
 
     typedef void (*PFUNC)(string parameters, StreamOutput *stream);
     typedef struct {
@@ -15,6 +15,7 @@ This is aprt of the Smoothie test framework, it generates a Mockable Kernl so ke
 #include "libs/nuts_bolts.h"
 #include "libs/SlowTicker.h"
 #include "libs/Adc.h"
+#include "libs/InputScanner.h"
 #include "libs/StreamOutputPool.h"
 #include <mri.h>
 #include "checksumm.h"
@@ -57,6 +58,7 @@ Kernel::Kernel(){
     this->current_path   = "/";
 
     this->slow_ticker = new SlowTicker();
+    this->input_scanner = new InputScanner();
 
     // dummies (would be nice to refactor to not have to create a conveyor)
     this->conveyor= new Conveyor();
@@ -0,0 +1,73 @@
+#include "AffineTransform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "easyunit/test.h"
+
+static float rnd(float range)
+{
+    return (rand() / (float)RAND_MAX - 0.5F) * 2 * range;
+}
+
+// with no skew the composed transform gives the same targets the separate offsets did, and leaves axes not given untouched
+TEST(AffineTransformTest,same_as_separate_offsets)
+{
+    srand(1);
+    for (int n = 0; n < 1000; ++n) {
+        float wcs[3], g92[3], tool[3], current[3], param[3];
+        for (int i = 0; i < 3; ++i) {
+            wcs[i] = rnd(200); g92[i] = rnd(50); tool[i] = rnd(20); current[i] = rnd(300);
+            param[i] = (rand() & 1) ? NAN : rnd(300);
+        }
+
+        AffineTransform t = AffineTransform::skew(0, 0, 0).then(AffineTransform::translation(
+            wcs[0] - g92[0] + tool[0], wcs[1] - g92[1] + tool[1], wcs[2] - g92[2] + tool[2]));
+        float from[3], target[3];
+        t.inverse().apply(current, from);
+        t.move_target(param, from, current, target);
+
+        for (int i = 0; i < 3; ++i) {
+            if(isnan(param[i])) {
+                ASSERT_TRUE(target[i] == current[i]);
+            } else {
+                ASSERT_EQUALS_DELTA_V((param[i] + wcs[i] - g92[i] + tool[i]), target[i], 0.0001F);
+            }
+        }
+    }
+}
+
+// with skew, a target is the skewed WCS position plus the offsets, and the inverse gets the WCS position back
+TEST(AffineTransformTest,skew_and_inverse)
+{
+    srand(2);
+    const float xy = 0.002F, xz = -0.001F, yz = 0.0015F;
+    AffineTransform t = AffineTransform::skew(xy, xz, yz).then(AffineTransform::translation(10, -20, 5));
+    AffineTransform inv = t.inverse();
+
+    for (int n = 0; n < 1000; ++n) {
+        float p[3] {rnd(300), rnd(300), rnd(100)}, m[3], back[3];
+        t.apply(p, m);
+        ASSERT_EQUALS_DELTA_V((p[0] - xy * p[1] - xz * p[2] + 10), m[0], 0.0001F);
+        ASSERT_EQUALS_DELTA_V((p[1] - yz * p[2] - 20), m[1], 0.0001F);
+        ASSERT_EQUALS_DELTA_V((p[2] + 5), m[2], 0.0001F);
+
+        inv.apply(m, back);
+        for (int i = 0; i < 3; ++i) ASSERT_EQUALS_DELTA_V(p[i], back[i], 0.0001F);
+    }
+
+    // moving just Z also moves X and Y as the skew says, moving just X leaves Y and Z alone
+    float current[3] {50, 60, 10}, from[3], target[3];
+    inv.apply(current, from);
+    float z_only[3] {NAN, NAN, from[2] + 10};
+    t.move_target(z_only, from, current, target);
+    ASSERT_EQUALS_DELTA_V((current[0] - xz * 10), target[0], 0.0001F);
+    ASSERT_EQUALS_DELTA_V((current[1] - yz * 10), target[1], 0.0001F);
+    ASSERT_EQUALS_DELTA_V((current[2] + 10), target[2], 0.0001F);
+
+    float x_only[3] {from[0] + 10, NAN, NAN};
+    t.move_target(x_only, from, current, target);
+    ASSERT_EQUALS_DELTA_V((current[0] + 10), target[0], 0.0001F);
+    ASSERT_TRUE(target[1] == current[1] && target[2] == current[2]);
+}
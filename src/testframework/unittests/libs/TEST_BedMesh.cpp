@@ -0,0 +1,326 @@
+#include "BedMesh.h"
+#include "MemoryPool.h"
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#include "easyunit/test.h"
+
+// MemoryPool peeks at the header just past the end of the region, so leave a zeroed one there
+static uint8_t pool_memory[8192 + 8];
+static MemoryPool pool(pool_memory, 8192);
+
+// a gently warped bed, +/- 0.2mm
+static float bed_height(float x, float y)
+{
+    return 0.2F * sinf(x / 30.0F) * cosf(y / 25.0F) + 0.0005F * x;
+}
+
+// what DeltaGridStrategy::doCompensation used to do on every segment
+static float old_delta_offset(const float *grid, int grid_size, float radius, float x, float y)
+{
+    int half = (grid_size - 1) / 2;
+    float grid_x = std::max(0.001F - half, std::min(half - 0.001F, x / ((2 * radius) / (grid_size - 1))));
+    float grid_y = std::max(0.001F - half, std::min(half - 0.001F, y / ((2 * radius) / (grid_size - 1))));
+    int floor_x = floorf(grid_x);
+    int floor_y = floorf(grid_y);
+    float ratio_x = grid_x - floor_x;
+    float ratio_y = grid_y - floor_y;
+    float z1 = grid[(floor_x + half) + ((floor_y + half) * grid_size)];
+    float z2 = grid[(floor_x + half) + ((floor_y + half + 1) * grid_size)];
+    float z3 = grid[(floor_x + half + 1) + ((floor_y + half) * grid_size)];
+    float z4 = grid[(floor_x + half + 1) + ((floor_y + half + 1) * grid_size)];
+    float left = (1 - ratio_y) * z1 + ratio_y * z2;
+    float right = (1 - ratio_y) * z3 + ratio_y * z4;
+    return (1 - ratio_x) * left + ratio_x * right;
+}
+
+static void probe_bed(BedMesh &mesh, int n, float radius, bool bicubic)
+{
+    mesh.allocate(n, n, bicubic);
+    mesh.set_bounds(-radius, -radius, radius, radius);
+    for (int y = 0; y < n; ++y) {
+        for (int x = 0; x < n; ++x) {
+            mesh.set(x, y, bed_height(mesh.get_x(x), mesh.get_y(y)));
+        }
+    }
+    mesh.build();
+}
+
+TEST(BedMeshTest,bilinear_matches_old_delta_grid)
+{
+    const int n= 7;
+    const float radius= 100;
+    BedMesh mesh(pool);
+    probe_bed(mesh, n, radius, false);
+
+    float grid[n * n];
+    for (int y = 0; y < n; ++y) {
+        for (int x = 0; x < n; ++x) {
+            grid[x + n * y]= mesh.get(x, y);
+        }
+    }
+
+    for (float y = -120; y <= 120; y += 3.7F) {
+        for (float x = -120; x <= 120; x += 2.9F) {
+            ASSERT_EQUALS_DELTA_V(old_delta_offset(grid, n, radius, x, y), mesh.interpolate(x, y), 0.0002F);
+        }
+    }
+}
+
+TEST(BedMeshTest,passes_through_grid_points)
+{
+    BedMesh mesh(pool);
+    for (int bicubic = 0; bicubic <= 1; ++bicubic) {
+        probe_bed(mesh, 9, 100, bicubic);
+        for (int y = 0; y < 9; ++y) {
+            for (int x = 0; x < 9; ++x) {
+                ASSERT_EQUALS_DELTA_V(mesh.get(x, y), mesh.interpolate(mesh.get_x(x), mesh.get_y(y)), (8 * mesh.get_resolution()));
+            }
+        }
+    }
+}
+
+TEST(BedMeshTest,plane_is_exact)
+{
+    BedMesh mesh(pool);
+    for (int bicubic = 0; bicubic <= 1; ++bicubic) {
+        mesh.allocate(5, 6, bicubic);
+        mesh.set_bounds(0, 0, 200, 250);
+        for (int y = 0; y < 6; ++y) {
+            for (int x = 0; x < 5; ++x) {
+                mesh.set(x, y, 0.001F * mesh.get_x(x) - 0.002F * mesh.get_y(y) + 0.1F);
+            }
+        }
+        mesh.build();
+        for (float y = 0; y <= 250; y += 7.3F) {
+            for (float x = 0; x <= 200; x += 5.1F) {
+                ASSERT_EQUALS_DELTA_V((0.001F * x - 0.002F * y + 0.1F), mesh.interpolate(x, y), 0.00001F);
+            }
+        }
+    }
+
+    // ZGrid carries on the slope of the edge cells outside the bed
+    mesh.allocate(5, 5, false);
+    mesh.set_bounds(0, 0, 200, 200);
+    mesh.set_extrapolate(true);
+    for (int y = 0; y < 5; ++y) {
+        for (int x = 0; x < 5; ++x) {
+            mesh.set(x, y, 0.001F * mesh.get_x(x));
+        }
+    }
+    mesh.build();
+    ASSERT_EQUALS_DELTA_V(0.25F, mesh.interpolate(250, 100), 0.00001F);
+    ASSERT_EQUALS_DELTA_V(-0.01F, mesh.interpolate(-10, -30), 0.00001F);
+}
+
+// Catmull-Rom through four points, t from p1 to p2
+static float catmull_rom(float p0, float p1, float p2, float p3, float t)
+{
+    return 0.5F * (2 * p1 + (p2 - p0) * t + (2 * p0 - 5 * p1 + 4 * p2 - p3) * t * t + (3 * p1 - p0 - 3 * p2 + p3) * t * t * t);
+}
+
+// float bicubic of an n by n grid over +/-radius, continued linearly past the edges
+static float reference_bicubic(const float *grid, int n, float radius, float x, float y)
+{
+    auto at= [grid, n](int i, int j) {
+        auto row= [grid, n](int i, int j) {
+            if(i < 0) return 2 * grid[n * j] - grid[1 + n * j];
+            if(i >= n) return 2 * grid[n - 1 + n * j] - grid[n - 2 + n * j];
+            return grid[i + n * j];
+        };
+        if(j < 0) return 2 * row(i, 0) - row(i, 1);
+        if(j >= n) return 2 * row(i, n - 1) - row(i, n - 2);
+        return row(i, j);
+    };
+    float gx= (x + radius) / (2 * radius / (n - 1)), gy= (y + radius) / (2 * radius / (n - 1));
+    int cx= std::min(n - 2, std::max(0, (int)floorf(gx))), cy= std::min(n - 2, std::max(0, (int)floorf(gy)));
+    float u= std::min(1.0F, std::max(0.0F, gx - cx)), v= std::min(1.0F, std::max(0.0F, gy - cy));
+    float r[4];
+    for (int j = 0; j < 4; ++j) r[j]= catmull_rom(at(cx - 1, cy - 1 + j), at(cx, cy - 1 + j), at(cx + 1, cy - 1 + j), at(cx + 2, cy - 1 + j), u);
+    return catmull_rom(r[0], r[1], r[2], r[3], v);
+}
+
+// the int16 grid against the same surface worked out in floats, for beds that fit in micrometres and ones that don't
+TEST(BedMeshTest,quantization_error)
+{
+    const int n= 15;
+    const float radius= 100;
+    const float ranges[]= {0.5F, 5.0F, 40.0F};
+    BedMesh mesh(pool);
+    for (int bicubic = 0; bicubic <= 1; ++bicubic) {
+        for (float range : ranges) {
+            mesh.allocate(n, n, bicubic);
+            mesh.set_bounds(-radius, -radius, radius, radius);
+            float grid[n * n];
+            for (int y = 0; y < n; ++y) {
+                for (int x = 0; x < n; ++x) {
+                    grid[x + n * y]= range * bed_height(mesh.get_x(x), mesh.get_y(y)) / 0.25F;
+                    mesh.set(x, y, grid[x + n * y]);
+                }
+            }
+            mesh.build();
+
+            // staying off the very edge, where the old delta code held back by a thousandth of a cell
+            float worst= 0;
+            for (float y = 0.5F - radius; y < radius; y += 1.7F) {
+                for (float x = 0.5F - radius; x < radius; x += 1.3F) {
+                    float z= bicubic ? reference_bicubic(grid, n, radius, x, y) : old_delta_offset(grid, n, radius, x, y);
+                    float e= fabsf(mesh.interpolate(x, y) - z);
+                    if(e > worst) worst= e;
+                }
+            }
+
+            // rounding the heights can be amplified by the bicubic weights by up to 1.25 each way, and each of the coefficients rounds
+            float bound= (bicubic ? 0.79F : 0.5F) * mesh.get_height_resolution() + (bicubic ? 8 : 2) * mesh.get_resolution() + range * 0.00001F;
+            ASSERT_TRUE(worst <= bound);
+        }
+    }
+}
+
+// compares the bilinear and bicubic surfaces against the real bed, and how sharply the slope changes
+// crossing a grid line, which shows up as ridges in the first layer
+TEST(BedMeshTest,bicubic_is_smoother)
+{
+    const float radius= 100;
+    const float h= 0.2F;
+    BedMesh mesh(pool);
+    float worst_error[2], worst_kink[2];
+    for (int bicubic = 0; bicubic <= 1; ++bicubic) {
+        probe_bed(mesh, 7, radius, bicubic);
+        worst_error[bicubic]= 0;
+        worst_kink[bicubic]= 0;
+        for (float y = -radius; y <= radius; y += 1.3F) {
+            for (float x = -radius; x <= radius; x += 1.1F) {
+                float e= fabsf(mesh.interpolate(x, y) - bed_height(x, y));
+                if(e > worst_error[bicubic]) worst_error[bicubic]= e;
+            }
+            // slope either side of each interior grid line in X
+            for (int i = 1; i < 6; ++i) {
+                float gx= mesh.get_x(i);
+                float before= (mesh.interpolate(gx, y) - mesh.interpolate(gx - h, y)) / h;
+                float after= (mesh.interpolate(gx + h, y) - mesh.interpolate(gx, y)) / h;
+                float kink= fabsf(after - before);
+                if(kink > worst_kink[bicubic]) worst_kink[bicubic]= kink;
+            }
+        }
+    }
+
+    ASSERT_TRUE(worst_error[1] < worst_error[0]);
+    ASSERT_TRUE(worst_kink[1] < worst_kink[0] / 10);
+}
+
+// splits a line the way Robot::append_mesh_segments does, returns the number of blocks and the worst Z error between them
+static int mesh_segments(const BedMesh &mesh, const float a[], const float b[], float max_error, float &worst)
+{
+    float t= 0;
+    int blocks= 0;
+    float len= hypotf(b[0] - a[0], b[1] - a[1]);
+    while(true) {
+        float nt= mesh.next_split(a, b, t, max_error);
+        if((1.0F - nt) * len < 0.0001F) nt= 1.0F;
+        float za= mesh.interpolate(a[0] + (b[0] - a[0]) * t, a[1] + (b[1] - a[1]) * t);
+        float zb= mesh.interpolate(a[0] + (b[0] - a[0]) * nt, a[1] + (b[1] - a[1]) * nt);
+        for (int i = 1; i < 20; ++i) {
+            float s= i / 20.0F, ts= t + (nt - t) * s;
+            float e= fabsf(mesh.interpolate(a[0] + (b[0] - a[0]) * ts, a[1] + (b[1] - a[1]) * ts) - (za + (zb - za) * s));
+            if(e > worst) worst= e;
+        }
+        blocks++;
+        if(nt >= 1.0F) return blocks;
+        t= nt;
+    }
+}
+
+// one layer of four 40mm square parts on a 200mm bed, three perimeters, 45 degree infill at 0.45mm and travel between them,
+// segmented to follow a 7x7 mesh with mm_per_line_segment 5 and with mm_max_mesh_error 0.01
+TEST(BedMeshTest,mesh_segmentation_block_count)
+{
+    std::vector<std::pair<float, float>> path;
+    const float corners[4][2]= {{20, 20}, {140, 20}, {140, 140}, {20, 140}};
+    for (auto &c : corners) {
+        for (int p = 0; p < 3; ++p) {
+            float lo= p * 0.45F, hi= 40 - p * 0.45F;
+            path.push_back({c[0] + lo, c[1] + lo});
+            path.push_back({c[0] + hi, c[1] + lo});
+            path.push_back({c[0] + hi, c[1] + hi});
+            path.push_back({c[0] + lo, c[1] + hi});
+            path.push_back({c[0] + lo, c[1] + lo});
+        }
+        // zig zag along x+y= k
+        float lo= 1.35F, hi= 40 - 1.35F;
+        int dir= 0;
+        for (float k = 2 * lo + 0.45F; k < 2 * hi; k += 0.45F * 1.4142F, dir ^= 1) {
+            float s0= std::max(lo, k - hi), s1= std::min(hi, k - lo);
+            if(dir) std::swap(s0, s1);
+            path.push_back({c[0] + s0, c[1] + k - s0});
+            path.push_back({c[0] + s1, c[1] + k - s1});
+        }
+    }
+
+    BedMesh mesh(pool);
+    for (int bicubic = 0; bicubic <= 1; ++bicubic) {
+        probe_bed(mesh, 7, 100, bicubic);
+        mesh.set_bounds(0, 0, 200, 200);
+        mesh.build();
+
+        int uniform= 0, split= 0;
+        float worst= 0;
+        for (size_t i = 1; i < path.size(); ++i) {
+            float a[2]= {path[i - 1].first, path[i - 1].second}, b[2]= {path[i].first, path[i].second};
+            uniform += std::max(1.0F, ceilf(hypotf(b[0] - a[0], b[1] - a[1]) / 5.0F));
+            split += mesh_segments(mesh, a, b, 0.01F, worst);
+        }
+        ASSERT_TRUE(worst < 0.011F);
+        ASSERT_TRUE(split < uniform);
+    }
+}
+
+TEST(BedMeshTest,image_round_trip)
+{
+    BedMesh mesh(pool);
+    probe_bed(mesh, 9, 100, false);
+    mesh.set(3, 4, NAN);
+
+    uint32_t size= mesh.image_size();
+    ASSERT_EQUALS(0, (int)(size % 512));
+    std::vector<uint8_t> image(size);
+    mesh.write_image(image.data(), 1.25F);
+
+    BedMesh loaded(pool);
+    loaded.allocate(5, 5, true);
+    float z_offset= 0;
+    ASSERT_TRUE(loaded.read_image(image.data(), size, z_offset) == nullptr);
+    ASSERT_EQUALS(9, loaded.get_nx());
+    ASSERT_EQUALS(9, loaded.get_ny());
+    ASSERT_EQUALS_DELTA_V(1.25F, z_offset, 0.0F);
+    ASSERT_EQUALS_DELTA_V(-100.0F, loaded.get_x(0), 0.0F);
+    ASSERT_EQUALS_DELTA_V(100.0F, loaded.get_y(8), 0.0F);
+    ASSERT_TRUE(isnan(loaded.get(3, 4)));
+    for (int y = 0; y < 9; ++y) {
+        for (int x = 0; x < 9; ++x) {
+            if(x == 3 && y == 4) continue;
+            ASSERT_EQUALS_DELTA_V(mesh.get(x, y), loaded.get(x, y), 0.0F);
+        }
+    }
+
+    // any flipped bit in the header or heights is caught, the padding is not covered
+    for (uint32_t i = 0; i < size; i += 7) {
+        image[i] ^= 0x10;
+        const char *error= loaded.read_image(image.data(), size, z_offset);
+        image[i] ^= 0x10;
+        ASSERT_TRUE((error != nullptr) == (i < 44 + 9 * 9 * 2));
+    }
+    ASSERT_TRUE(loaded.read_image(image.data(), 100, z_offset) != nullptr);
+
+    // a grid too big for the pool is refused and the one already loaded is kept
+    BedMesh big(pool);
+    probe_bed(big, 20, 100, false);
+    std::vector<uint8_t> big_image(big.image_size());
+    big.write_image(big_image.data(), 0);
+    ASSERT_TRUE(loaded.read_image(big_image.data(), big.image_size(), z_offset) != nullptr);
+    ASSERT_TRUE(loaded.is_allocated());
+    ASSERT_EQUALS(9, loaded.get_nx());
+    ASSERT_EQUALS_DELTA_V(mesh.get(5, 5), loaded.get(5, 5), 0.0F);
+}
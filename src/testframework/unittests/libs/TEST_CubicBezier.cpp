@@ -0,0 +1,114 @@
+#include "CubicBezier.h"
+#include "Vector3.h"
+
+#include <math.h>
+
+#include "easyunit/test.h"
+
+// distance from p to the line segment a b
+static float distance_to_segment(const Vector3 &p, const Vector3 &a, const Vector3 &b)
+{
+    Vector3 ab= b.sub(a);
+    float t= p.sub(a).dot(ab) / ab.magsq();
+    if(t < 0) t= 0;
+    if(t > 1) t= 1;
+    return p.sub(a.add(ab.mul(t))).mag();
+}
+
+// flatten the curve the way Robot does and return the furthest any of the lines get from the polyline a c b
+static float max_deviation(const CubicBezier &curve, float max_error, const Vector3 &a, const Vector3 &c, const Vector3 &b)
+{
+    float worst= 0;
+    float t= 0;
+    Vector3 last= curve.point(0);
+    while(t < 1.0F) {
+        t= curve.next_t(t, max_error);
+        Vector3 pt= curve.point(t);
+        for (int i = 0; i <= 10; ++i) {
+            Vector3 q= last.add(pt.sub(last).mul(i / 10.0F));
+            float d= fminf(distance_to_segment(q, a, c), distance_to_segment(q, c, b));
+            if(d > worst) worst= d;
+        }
+        last= pt;
+    }
+    return worst;
+}
+
+// blend corners of 10 to 170 degrees the way G64 P does and check the path never strays further than the tolerance
+TEST(CubicBezierTest,corner_blend_within_tolerance)
+{
+    const float tolerances[]= {0.01F, 0.05F, 0.2F};
+    for(float tol : tolerances) {
+        for (int deg = 10; deg <= 170; deg += 20) {
+            float turn= deg * M_PI / 180.0F;
+            Vector3 a(-100, 0, 0), c(0, 0, 0), b(100 * cosf(turn), 100 * sinf(turn), 0);
+            Vector3 u_in= c.sub(a).unit(), u_out= b.sub(c).unit();
+
+            float l= CubicBezier::corner_blend_length(u_in, u_out, tol * 0.75F);
+            ASSERT_TRUE(l > 0 && l < 100);
+            CubicBezier blend= CubicBezier::corner_blend(c.sub(u_in.mul(l)), c, c.add(u_out.mul(l)));
+
+            // blend starts and ends on the lines and is tangent to them
+            ASSERT_EQUALS_DELTA_V(0.0F, blend.point(0).sub(c.sub(u_in.mul(l))).mag(), 0.0001F);
+            ASSERT_EQUALS_DELTA_V(0.0F, blend.point(1).sub(c.add(u_out.mul(l))).mag(), 0.0001F);
+            ASSERT_EQUALS_DELTA_V(1.0F, blend.point(0.001F).sub(blend.point(0)).unit().dot(u_in), 0.001F);
+            ASSERT_EQUALS_DELTA_V(1.0F, blend.point(1).sub(blend.point(0.999F)).unit().dot(u_out), 0.001F);
+
+            float d= max_deviation(blend, tol * 0.25F, a, c, b);
+            ASSERT_TRUE(d <= tol);
+        }
+    }
+}
+
+// the flattened curve stays within the error asked for, allowing a little for the curvature estimate
+TEST(CubicBezierTest,flatten_within_error)
+{
+    CubicBezier curve(Vector3(0, 0, 0), Vector3(10, 20, 0), Vector3(30, -20, 0), Vector3(40, 0, 0));
+    float t= 0;
+    Vector3 last= curve.point(0);
+    float worst= 0;
+    int segments= 0;
+    while(t < 1.0F) {
+        float nt= curve.next_t(t, 0.01F);
+        Vector3 pt= curve.point(nt);
+        for (int i = 1; i < 20; ++i) {
+            Vector3 q= curve.point(t + (nt - t) * i / 20.0F);
+            float d= distance_to_segment(q, last, pt);
+            if(d > worst) worst= d;
+        }
+        last= pt;
+        t= nt;
+        segments++;
+    }
+    ASSERT_TRUE(worst < 0.011F);
+    ASSERT_TRUE(segments < 100);
+}
+
+// a long gentle G5 flattens into few long chords, they are only within the error of the curve, so they still have to
+// be split up like any other line for a delta or a bed mesh. Check they tile the curve in order and end on it
+TEST(CubicBezierTest,flatten_long_gentle_curve)
+{
+    CubicBezier curve(Vector3(0, 0, 0), Vector3(100, 5, 1), Vector3(200, -5, 2), Vector3(300, 0, 3));
+    float t= 0;
+    Vector3 last= curve.point(0);
+    float worst= 0, longest= 0;
+    int segments= 0;
+    while(t < 1.0F) {
+        float nt= curve.next_t(t, 0.01F);
+        ASSERT_TRUE(nt > t);
+        Vector3 pt= curve.point(nt);
+        for (int i = 1; i < 20; ++i) {
+            Vector3 q= curve.point(t + (nt - t) * i / 20.0F);
+            float d= distance_to_segment(q, last, pt);
+            if(d > worst) worst= d;
+        }
+        float l= pt.sub(last).mag();
+        if(l > longest) longest= l;
+        last= pt;
+        t= nt;
+        segments++;
+    }
+    ASSERT_TRUE(t == 1.0F);
+    ASSERT_TRUE(worst < 0.011F);
+    ASSERT_TRUE(longest > 10.0F && segments < 50);
+}
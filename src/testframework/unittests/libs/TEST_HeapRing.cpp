@@ -0,0 +1,105 @@
+#include "HeapRing.h"
+#include "HeapRing.cpp"
+
+#include <stdint.h>
+
+#include "easyunit/test.h"
+
+#if !defined(__arm__)
+#include <thread>
+#endif
+
+TEST(HeapRingTest,length_is_a_power_of_two)
+{
+    HeapRing<int> ring(5);
+    ASSERT_EQUALS(3, (int)ring.capacity());
+
+    ASSERT_TRUE(ring.resize(32));
+    ASSERT_EQUALS(31, (int)ring.capacity());
+    ASSERT_TRUE(ring.resize(63));
+    ASSERT_EQUALS(31, (int)ring.capacity());
+    ASSERT_TRUE(ring.resize(1));
+    ASSERT_EQUALS(1, (int)ring.capacity());
+
+    int a[6];
+    ASSERT_TRUE(!ring.provide(a, 6));
+}
+
+TEST(HeapRingTest,push_pop_and_wrap)
+{
+    HeapRing<int> ring(4);
+    int v;
+
+    ASSERT_TRUE(ring.is_empty());
+    ASSERT_TRUE(!ring.pop(v));
+
+    // go round several times so the indexes wrap
+    int next_in= 0, next_out= 0;
+    for (int i = 0; i < 10; ++i) {
+        while(ring.push(next_in)) next_in++;
+        ASSERT_TRUE(ring.is_full());
+        ASSERT_EQUALS(3, (int)ring.size());
+        ASSERT_EQUALS(next_out, ring.peek(0));
+        ASSERT_EQUALS(next_out + 2, ring.peek(2));
+
+        ASSERT_TRUE(ring.pop(v));
+        ASSERT_EQUALS(next_out++, v);
+        ASSERT_EQUALS(2, (int)ring.size());
+        while(ring.pop(v)) ASSERT_EQUALS(next_out++, v);
+        ASSERT_TRUE(ring.is_empty());
+    }
+    ASSERT_EQUALS(30, next_out);
+}
+
+// one side pushes a counting sequence while the other pops it, every value must come out once and in order
+static uint32_t stress(HeapRing<uint32_t> &ring, uint32_t n)
+{
+    uint32_t bad= 0;
+
+#if !defined(__arm__)
+    std::thread producer([&ring, n]() {
+        for (uint32_t i = 0; i < n; ) {
+            if(ring.push(i)) i++;
+            else std::this_thread::yield();
+        }
+    });
+
+    uint32_t expect= 0;
+    while(expect < n) {
+        uint32_t v;
+        if(!ring.pop(v)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if(v != expect) bad++;
+        expect= v + 1;
+    }
+    producer.join();
+
+#else
+    // no threads on the target, interleave bursts of each side instead
+    uint32_t in= 0, expect= 0, seed= 1;
+    while(expect < n) {
+        seed= seed * 1103515245 + 12345;
+        uint32_t burst= (seed >> 16) & 15;
+        for (uint32_t j = 0; j < burst && in < n && ring.push(in); ++j) in++;
+        burst= (seed >> 20) & 15;
+        uint32_t v;
+        for (uint32_t j = 0; j < burst && ring.pop(v); ++j) {
+            if(v != expect) bad++;
+            expect= v + 1;
+        }
+    }
+#endif
+
+    return bad + (ring.is_empty() ? 0 : 1);
+}
+
+TEST(HeapRingTest,one_producer_one_consumer)
+{
+    HeapRing<uint32_t> small(2);
+    ASSERT_EQUALS(0, (int)stress(small, 100000));
+
+    HeapRing<uint32_t> big(64);
+    ASSERT_EQUALS(0, (int)stress(big, 1000000));
+}
@@ -0,0 +1,74 @@
+#include "InputScanner.h"
+
+#include <stdio.h>
+#include <vector>
+
+#include "easyunit/test.h"
+
+// run n ticks with the same port samples, the handlers record events as +n for on and -n for off
+static void scan_n(InputScanner &scanner, const uint32_t sample[InputScanner::ports], int n)
+{
+    for (int i = 0; i < n; ++i) scanner.scan(sample);
+}
+
+TEST(InputScannerTest,debounces_and_reports_edges)
+{
+    InputScanner scanner;
+    std::vector<int> events;
+    int a= scanner.attach(1, 5, false, false, [&events](bool s) { events.push_back(s ? 1 : -1); });
+    int b= scanner.attach(2, 0, true, false, [&events](bool s) { events.push_back(s ? 2 : -2); });
+
+    uint32_t idle[InputScanner::ports]= {0, 0, 1, 0, 0}; // b is inverted so its pin high is off
+    uint32_t both[InputScanner::ports]= {0, 1 << 5, 0, 0, 0};
+
+    scan_n(scanner, idle, 10);
+    ASSERT_EQUALS(0, (int)events.size());
+
+    // three samples in a row is a glitch and is ignored
+    scan_n(scanner, both, 3);
+    scan_n(scanner, idle, 1);
+    ASSERT_EQUALS(0, (int)events.size());
+    ASSERT_TRUE(!scanner.get(a));
+
+    // the fourth changes it, and both inputs are reported on the same tick
+    scan_n(scanner, both, 3);
+    ASSERT_EQUALS(0, (int)events.size());
+    scan_n(scanner, both, 1);
+    ASSERT_EQUALS(2, (int)events.size());
+    ASSERT_EQUALS(1, events[0]);
+    ASSERT_EQUALS(2, events[1]);
+    ASSERT_TRUE(scanner.get(a));
+    ASSERT_TRUE(scanner.get(b));
+
+    // staying on is not reported again
+    scan_n(scanner, both, 20);
+    ASSERT_EQUALS(2, (int)events.size());
+
+    // a bouncing release only counts once it has settled
+    for (int i = 0; i < 5; ++i) {
+        scan_n(scanner, idle, 2);
+        scan_n(scanner, both, 1);
+    }
+    ASSERT_EQUALS(2, (int)events.size());
+    scan_n(scanner, idle, 4);
+    ASSERT_EQUALS(4, (int)events.size());
+    ASSERT_EQUALS(-1, events[2]);
+    ASSERT_EQUALS(-2, events[3]);
+    ASSERT_TRUE(!scanner.get(a));
+}
+
+TEST(InputScannerTest,other_bits_are_ignored)
+{
+    InputScanner scanner;
+    int changes= 0;
+    int a= scanner.attach(0, 31, false, true, [&changes](bool s) { changes++; });
+
+    // starts in the state given, and noise on the other bits of the port doesn't affect it
+    uint32_t sample[InputScanner::ports]= {0x80000000UL, 0xFFFFFFFFUL, 0, 0, 0};
+    for (int i = 0; i < 100; ++i) {
+        sample[0]= 0x80000000UL | (i * 0x9E3779B9UL >> 1);
+        scanner.scan(sample);
+    }
+    ASSERT_EQUALS(0, changes);
+    ASSERT_TRUE(scanner.get(a));
+}
@@ -0,0 +1,59 @@
+#include "IsrProfiler.h"
+
+#include "easyunit/test.h"
+
+TEST(IsrProfilerTest,records_min_max_mean_and_histogram)
+{
+    IsrProfiler p;
+    ASSERT_EQUALS(0, (int)p.get(IsrProfiler::STEP_TICKER).count);
+
+    p.record(IsrProfiler::STEP_TICKER, 150);
+    p.record(IsrProfiler::STEP_TICKER, 200);
+    p.record(IsrProfiler::STEP_TICKER, 100);
+    p.record(IsrProfiler::STEP_TICKER, 1000);
+    p.record(IsrProfiler::SLOW_TICKER, 5000);
+
+    const IsrProfiler::stats_t &s= p.get(IsrProfiler::STEP_TICKER);
+    ASSERT_EQUALS(4, (int)s.count);
+    ASSERT_EQUALS(100, (int)s.min);
+    ASSERT_EQUALS(1000, (int)s.max);
+    ASSERT_EQUALS(362, (int)(s.total / s.count));
+
+    // 100 is in 64-127, 150 and 200 in 128-255, 1000 in 512-1023
+    ASSERT_EQUALS(1, (int)s.histogram[7]);
+    ASSERT_EQUALS(2, (int)s.histogram[8]);
+    ASSERT_EQUALS(1, (int)s.histogram[10]);
+    ASSERT_EQUALS(1, (int)p.get(IsrProfiler::SLOW_TICKER).count);
+    ASSERT_EQUALS(0, (int)p.get(IsrProfiler::PENDSV).count);
+}
+
+TEST(IsrProfilerTest,buckets)
+{
+    ASSERT_EQUALS(0, IsrProfiler::bucket(0));
+    ASSERT_EQUALS(1, IsrProfiler::bucket(1));
+    ASSERT_EQUALS(2, IsrProfiler::bucket(2));
+    ASSERT_EQUALS(2, IsrProfiler::bucket(3));
+    ASSERT_EQUALS(11, IsrProfiler::bucket(1024));
+    ASSERT_EQUALS(IsrProfiler::buckets - 1, IsrProfiler::bucket(0xFFFFFFFFUL));
+}
+
+TEST(IsrProfilerTest,reset_takes_effect_on_the_next_record)
+{
+    IsrProfiler p;
+    p.record(IsrProfiler::PENDSV, 10000);
+    p.record(IsrProfiler::ACCELERATION, 300);
+
+    p.reset();
+    ASSERT_TRUE(p.get(IsrProfiler::PENDSV).reset);
+
+    p.record(IsrProfiler::PENDSV, 20);
+    const IsrProfiler::stats_t &s= p.get(IsrProfiler::PENDSV);
+    ASSERT_TRUE(!s.reset);
+    ASSERT_EQUALS(1, (int)s.count);
+    ASSERT_EQUALS(20, (int)s.min);
+    ASSERT_EQUALS(20, (int)s.max);
+    ASSERT_EQUALS(0, (int)s.histogram[IsrProfiler::bucket(10000)]);
+
+    // the others are still waiting for their next record
+    ASSERT_TRUE(p.get(IsrProfiler::ACCELERATION).reset);
+}
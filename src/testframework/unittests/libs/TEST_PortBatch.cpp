@@ -0,0 +1,90 @@
+#include "PortBatch.h"
+
+#include <string.h>
+
+#include "easyunit/test.h"
+
+// register files standing in for GPIO ports, the batch only writes FIOSET and FIOCLR so each holds the last mask written
+static LPC_GPIO_TypeDef fake_gpio[2];
+
+static void clear_fake_gpio()
+{
+    memset(fake_gpio, 0, sizeof fake_gpio);
+}
+
+TEST(PortBatchTest,pins_on_a_port_are_written_together)
+{
+    clear_fake_gpio();
+    PortBatch batch;
+    PortBatch::pin_t x= batch.add(&fake_gpio[0], 20, false);
+    PortBatch::pin_t y= batch.add(&fake_gpio[0], 23, false);
+    PortBatch::pin_t z= batch.add(&fake_gpio[1], 2, false);
+    PortBatch::pin_t nc= batch.add(nullptr, 0, false);
+
+    ASSERT_EQUALS(x.port, y.port);
+    ASSERT_TRUE(x.port != z.port);
+    ASSERT_EQUALS(0, (int)nc.mask);
+
+    // nothing pulsed writes nothing
+    ASSERT_TRUE(!batch.output());
+    ASSERT_EQUALS(0, (int)fake_gpio[0].FIOSET);
+
+    batch.pulse(x);
+    batch.pulse(y);
+    batch.pulse(nc);
+    ASSERT_TRUE(batch.output());
+    ASSERT_EQUALS((1UL << 20) | (1UL << 23), fake_gpio[0].FIOSET);
+    ASSERT_EQUALS(0, (int)fake_gpio[0].FIOCLR);
+    ASSERT_EQUALS(0, (int)fake_gpio[1].FIOSET);
+
+    batch.reset();
+    ASSERT_EQUALS((1UL << 20) | (1UL << 23), fake_gpio[0].FIOCLR);
+    ASSERT_EQUALS(0, (int)fake_gpio[1].FIOCLR);
+
+    // once reset they are not written again
+    clear_fake_gpio();
+    batch.reset();
+    ASSERT_EQUALS(0, (int)fake_gpio[0].FIOCLR);
+}
+
+TEST(PortBatchTest,inverted_pins_pulse_low)
+{
+    clear_fake_gpio();
+    PortBatch batch;
+    PortBatch::pin_t a= batch.add(&fake_gpio[1], 0, false);
+    PortBatch::pin_t b= batch.add(&fake_gpio[1], 31, true);
+
+    batch.pulse(a);
+    batch.pulse(b);
+    batch.output();
+    ASSERT_EQUALS(1UL, fake_gpio[1].FIOSET);
+    ASSERT_EQUALS(1UL << 31, fake_gpio[1].FIOCLR);
+
+    clear_fake_gpio();
+    batch.reset();
+    ASSERT_EQUALS(1UL, fake_gpio[1].FIOCLR);
+    ASSERT_EQUALS(1UL << 31, fake_gpio[1].FIOSET);
+}
+
+TEST(PortBatchTest,pulses_after_output_wait_for_the_next_one)
+{
+    clear_fake_gpio();
+    PortBatch batch;
+    PortBatch::pin_t a= batch.add(&fake_gpio[0], 4, false);
+    PortBatch::pin_t b= batch.add(&fake_gpio[0], 5, false);
+
+    batch.pulse(a);
+    batch.output();
+
+    // b is marked for the next tick when the reset of a comes in, it is not set or lost
+    batch.pulse(b);
+    clear_fake_gpio();
+    batch.reset();
+    ASSERT_EQUALS(1UL << 4, fake_gpio[0].FIOCLR);
+
+    clear_fake_gpio();
+    ASSERT_TRUE(batch.output());
+    ASSERT_EQUALS(1UL << 5, fake_gpio[0].FIOSET);
+    batch.reset();
+    ASSERT_EQUALS(1UL << 5, fake_gpio[0].FIOCLR);
+}
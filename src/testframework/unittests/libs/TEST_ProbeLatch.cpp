@@ -0,0 +1,81 @@
+#include "ProbeLatch.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "easyunit/test.h"
+
+TEST(ProbeLatchTest,captures_only_when_armed)
+{
+    volatile int32_t z= 100;
+    const volatile int32_t *counters[1]= {&z};
+    ProbeLatch latch;
+
+    ASSERT_TRUE(!latch.capture());
+    ASSERT_TRUE(!latch.is_latched());
+
+    latch.arm(counters, 1);
+    ASSERT_TRUE(latch.is_armed());
+    z= 40;
+    ASSERT_TRUE(latch.capture());
+    ASSERT_TRUE(latch.is_latched());
+    ASSERT_EQUALS(-60, latch.moved(0));
+
+    // only the first edge is latched
+    z= 30;
+    ASSERT_TRUE(!latch.capture());
+    ASSERT_EQUALS(40, latch.get_position(0));
+    ASSERT_EQUALS(-10, latch.overrun(0));
+
+    // after a rearm the next edge replaces it, still measured from where it was armed
+    latch.rearm();
+    z= 20;
+    ASSERT_TRUE(latch.capture());
+    ASSERT_EQUALS(-80, latch.moved(0));
+
+    latch.arm(counters, 1);
+    latch.disarm();
+    ASSERT_TRUE(!latch.capture());
+}
+
+// Step three delta actuators down together at 100kHz ticks onto a bed, the edge interrupt capturing the instant the
+// probe triggers and then ramping down
+TEST(ProbeLatchTest,latched_position_is_exact_at_any_speed)
+{
+    const float steps_per_mm= 100, acc= 3000, tick_rate= 100000;
+    const float speeds[]= {5, 20, 50, 100};
+
+    for(float speed : speeds) {
+        volatile int32_t act[3]= {1000, 1000, 1000};
+        const volatile int32_t *counters[3]= {&act[0], &act[1], &act[2]};
+        ProbeLatch latch;
+        latch.arm(counters, 3);
+
+        const int32_t bed= 1000 - 1234; // the step on which the probe goes on
+        float v= 0, fraction= 0;
+        bool decelerating= false;
+        for (int tick = 0; tick < 10000000 && (v > 0 || !decelerating); ++tick) {
+            if(decelerating) v= fmaxf(0, v - acc / tick_rate);
+            else v= fminf(speed, v + acc / tick_rate);
+
+            fraction += v * steps_per_mm / tick_rate;
+            if(fraction >= 1) {
+                fraction -= 1;
+                for (int i = 0; i < 3; ++i) act[i]--;
+                if(act[2] == bed && latch.capture()) decelerating= true;
+            }
+        }
+
+        ASSERT_TRUE(latch.is_latched());
+        for (int i = 0; i < 3; ++i) {
+            ASSERT_EQUALS(bed, latch.get_position(i));
+            ASSERT_EQUALS(bed - 1000, latch.moved(i));
+        }
+
+        // stepping back by the overrun leaves them on the trigger point
+        int32_t overrun= latch.overrun(2);
+        for (int i = 0; i < 3; ++i) act[i] -= overrun;
+        ASSERT_EQUALS(0, latch.overrun(0));
+        ASSERT_EQUALS(bed, act[2]);
+    }
+}
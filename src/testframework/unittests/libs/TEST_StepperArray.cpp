@@ -0,0 +1,37 @@
+#include "StepperArray.h"
+
+#include "easyunit/test.h"
+
+// count the steps each motor makes, taking the period back off as the StepperMotor does
+struct StepCounter {
+    StepperArray &s;
+    uint32_t steps[StepperArray::max_motors];
+    StepCounter(StepperArray &a) : s(a) { for (auto &i : steps) i= 0; }
+    void operator()(uint32_t i) { s.fx_counter[i] -= s.fx_ticks_per_step[i]; steps[i]++; }
+};
+
+TEST(StepperArrayTest,unrolled_matches_generic)
+{
+    StepperArray a, b;
+    for (uint32_t i = 0; i < 8; ++i) {
+        a.fx_ticks_per_step[i]= b.fx_ticks_per_step[i]= StepperArray::fx_increment * (i + 2) + i * 1000;
+    }
+    // motor 2 is idle and 9 is past the unrolled ones
+    a.fx_ticks_per_step[9]= b.fx_ticks_per_step[9]= StepperArray::fx_increment * 3;
+    a.active= b.active= 0x2FB;
+
+    StepCounter ca(a), cb(b);
+    for (int t = 0; t < 10000; ++t) {
+        a.tick(0, [&ca](uint32_t i) { ca(i); });
+        b.tick_unrolled<8>([&cb](uint32_t i) { cb(i); });
+        b.tick(8, [&cb](uint32_t i) { cb(i); });
+    }
+
+    ASSERT_EQUALS(0, (int)ca.steps[2]);
+    ASSERT_EQUALS(5000, (int)ca.steps[0]);
+    ASSERT_EQUALS(3333, (int)ca.steps[9]);
+    for (uint32_t i = 0; i < StepperArray::max_motors; ++i) {
+        ASSERT_EQUALS(ca.steps[i], cb.steps[i]);
+        ASSERT_EQUALS(a.fx_counter[i], b.fx_counter[i]);
+    }
+}
@@ -0,0 +1,56 @@
+#include "arc_segments.h"
+
+#include <math.h>
+
+#include "easyunit/test.h"
+
+// cut arcs the way Robot does for G2/G3 with mm_max_arc_error set, and measure how far the chords get from the arc
+TEST(ArcSegmentsTest,chords_within_error)
+{
+    const float radii[]= {0.2F, 1.0F, 10.0F, 100.0F, 500.0F};
+    const float errors[]= {0.001F, 0.01F, 0.1F};
+    const float travels[]= {0.05F, (float)M_PI / 2, -(float)M_PI, 2 * (float)M_PI};
+    double worst_ratio= 0;
+
+    for(float r : radii) {
+        for(float e : errors) {
+            for(float a : travels) {
+                int n= arc_segments_for_error(a, r, e);
+                ASSERT_TRUE(n >= 1);
+
+                // the middle of each chord is the furthest point from the arc, measured in double so it is the count
+                // being checked and not the rounding of the measurement
+                double theta= (double)a / n;
+                double x0= r, y0= 0, worst= 0;
+                for (int i = 1; i <= n; ++i) {
+                    double x1= r * cos(i * theta), y1= r * sin(i * theta);
+                    double d= r - hypot((x0 + x1) / 2, (y0 + y1) / 2);
+                    if(d > worst) worst= d;
+                    x0= x1; y0= y1;
+                }
+                if(worst / e > worst_ratio) worst_ratio= worst / e;
+
+                // and it is the fewest that will do
+                if(n > 1) {
+                    float coarser= a / (n - 1);
+                    ASSERT_TRUE(r * (1 - cosf(coarser / 2)) > e * 0.99F);
+                }
+            }
+        }
+    }
+    ASSERT_TRUE(worst_ratio <= 1.0001); // a float rounding over at most
+}
+
+TEST(ArcSegmentsTest,segment_counts)
+{
+    // an error bigger than the radius, a whole circle is still at least one segment
+    ASSERT_EQUALS(1, (int)arc_segments_for_error(2 * M_PI, 0.1F, 1.0F));
+    ASSERT_EQUALS(1, (int)arc_segments_for_error(0.0F, 10.0F, 0.01F));
+
+    // a quarter circle of radius 10 to within 0.01mm needs chords of no more than 5.1 degrees
+    ASSERT_EQUALS(18, (int)arc_segments_for_error(M_PI / 2, 10.0F, 0.01F));
+    ASSERT_EQUALS(18, (int)arc_segments_for_error(-M_PI / 2, 10.0F, 0.01F));
+
+    // too fine for a float to resolve against the radius, as many as can be counted rather than overflowing
+    ASSERT_EQUALS(65535, (int)arc_segments_for_error(2 * M_PI, 1000.0F, 0.000001F));
+}
@@ -0,0 +1,79 @@
+#include "Kernel.h"
+#include "Test_kernel.h"
+#include "BaseSolution.h"
+#include "RotaryDeltaSolution.h"
+#include "MorganSCARASolution.h"
+#include "fast_trig.h"
+
+#include <math.h>
+#include <memory>
+
+#include "easyunit/test.h"
+
+TEST(FastTrigTest,atan2_error_bound)
+{
+    float worst = 0;
+    for (int i = -18000; i <= 18000; ++i) {
+        float a = i * M_PI / 18000.0;
+        for(float r : {0.001F, 1.0F, 300.0F}) {
+            float e = fabsf(fast_atan2f(r * sinf(a), r * cosf(a)) - atan2f(r * sinf(a), r * cosf(a)));
+            if(e > M_PI) e = fabsf(e - 2 * M_PI); // +-pi are the same angle
+            if(e > worst) worst = e;
+        }
+    }
+    ASSERT_TRUE(worst < 1.2e-5F);
+}
+
+// sweep the work envelope in 1mm steps comparing actuator angles from the two solutions,
+// returns the worst difference in degrees
+static float sweep(BaseSolution *exact, BaseSolution *fast, const float min[3], const float max[3])
+{
+    float worst = 0;
+    for (float z = min[2]; z <= max[2]; z += 10) {
+        for (float y = min[1]; y <= max[1]; y += 1) {
+            for (float x = min[0]; x <= max[0]; x += 1) {
+                float p[3] {x, y, z};
+                ActuatorCoordinates a, b;
+                exact->cartesian_to_actuator(p, a);
+                fast->cartesian_to_actuator(p, b);
+                for (int i = 0; i < 3; ++i) {
+                    float d = fabsf(a[i] - b[i]);
+                    if(d > worst) worst = d;
+                }
+            }
+        }
+    }
+    return worst;
+}
+
+TEST(FastTrigTest,morgan_scara_envelope)
+{
+    const static char exact_config[] = "morgan_fast_trig false\n";
+    const static char fast_config[] = "morgan_fast_trig true\n";
+    test_kernel_setup_config(exact_config, &exact_config[sizeof(exact_config)]);
+    std::unique_ptr<BaseSolution> exact(new MorganSCARASolution(THEKERNEL->config));
+    test_kernel_teardown();
+    test_kernel_setup_config(fast_config, &fast_config[sizeof(fast_config)]);
+    std::unique_ptr<BaseSolution> fast(new MorganSCARASolution(THEKERNEL->config));
+    test_kernel_teardown();
+
+    // the default arms reach 300mm from the tower at 100,-60, including the clamped areas at the limits
+    const float min[3] {-200, -60, 0}, max[3] {200, 240, 0};
+    // psi arm angle adds up three atan2 errors
+    ASSERT_TRUE(sweep(exact.get(), fast.get(), min, max) < 0.0021F);
+}
+
+TEST(FastTrigTest,rotary_delta_envelope)
+{
+    const static char exact_config[] = "delta_fast_trig false\n";
+    const static char fast_config[] = "delta_fast_trig true\n";
+    test_kernel_setup_config(exact_config, &exact_config[sizeof(exact_config)]);
+    std::unique_ptr<BaseSolution> exact(new RotaryDeltaSolution(THEKERNEL->config));
+    test_kernel_teardown();
+    test_kernel_setup_config(fast_config, &fast_config[sizeof(fast_config)]);
+    std::unique_ptr<BaseSolution> fast(new RotaryDeltaSolution(THEKERNEL->config));
+    test_kernel_teardown();
+
+    const float min[3] {-100, -100, -60}, max[3] {100, 100, 0};
+    ASSERT_TRUE(sweep(exact.get(), fast.get(), min, max) < 0.001F);
+}
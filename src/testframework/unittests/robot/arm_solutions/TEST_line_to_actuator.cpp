@@ -0,0 +1,67 @@
+#include "Kernel.h"
+#include "Test_kernel.h"
+#include "BaseSolution.h"
+#include "CartesianSolution.h"
+#include "RotatableCartesianSolution.h"
+#include "HBotSolution.h"
+#include "CoreXZSolution.h"
+#include "LinearDeltaSolution.h"
+#include "RotaryDeltaSolution.h"
+#include "MorganSCARASolution.h"
+
+#include <math.h>
+#include <memory>
+
+#include "easyunit/test.h"
+
+// convert n points along the line both ways and return the largest difference
+static float compare(BaseSolution *arm, const float start[], const float end[], int n)
+{
+    float delta[3];
+    for (int i = 0; i < 3; i++) delta[i] = (end[i] - start[i]) / (n - 1);
+
+    std::unique_ptr<ActuatorCoordinates[]> scalar(new ActuatorCoordinates[n]), batch(new ActuatorCoordinates[n]);
+    for (int k = 0; k < n; k++) {
+        float p[3];
+        for (int i = 0; i < 3; i++) p[i] = start[i] + delta[i] * k;
+        arm->cartesian_to_actuator(p, scalar[k]);
+    }
+    arm->cartesian_line_to_actuator(start, delta, n, batch.get());
+
+    float worst = 0;
+    for (int k = 0; k < n; k++) {
+        for (size_t i = 0; i < arm->get_actuator_count(); i++) {
+            float d = fabsf(scalar[k][i] - batch[k][i]);
+            if(d > worst) worst = d;
+        }
+    }
+    return worst;
+}
+
+const static char config[] = "arm_length 250\narm_radius 124\n";
+
+TEST(LineToActuatorTest,every_arm_solution_matches_scalar)
+{
+    test_kernel_setup_config(config, &config[sizeof(config)]);
+
+    struct { BaseSolution *arm; float start[3], end[3]; } arms[] = {
+        {new CartesianSolution(THEKERNEL->config),          {0, 0, 0},       {200, 100, 10}},
+        {new RotatableCartesianSolution(THEKERNEL->config), {0, 0, 0},       {200, 100, 10}},
+        {new HBotSolution(THEKERNEL->config),               {0, 0, 0},       {200, 100, 10}},
+        {new CoreXZSolution(THEKERNEL->config),             {0, 0, 0},       {200, 100, 10}},
+        {new LinearDeltaSolution(THEKERNEL->config),        {-100, -50, 0},  {100, 50, 5}},
+        {new RotaryDeltaSolution(THEKERNEL->config),        {-80, -40, -40}, {80, 40, -40}},
+        {new MorganSCARASolution(THEKERNEL->config),        {0, 0, 0},       {100, 100, 10}},
+    };
+
+    for(auto &a : arms) {
+        // a short batch like Robot uses and a long one, the error would build up over that without the exact restarts
+        float d1 = compare(a.arm, a.start, a.end, 8);
+        float d2 = compare(a.arm, a.start, a.end, 1000);
+        // an eighth of a step at 80 steps/mm, or 0.01 degree for the angular ones
+        ASSERT_TRUE(d1 < 0.0015F && d2 < 0.0015F);
+        delete a.arm;
+    }
+
+    test_kernel_teardown();
+}
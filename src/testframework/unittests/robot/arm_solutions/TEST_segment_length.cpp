@@ -0,0 +1,108 @@
+#include "Kernel.h"
+#include "Test_kernel.h"
+#include "BaseSolution.h"
+#include "LinearDeltaSolution.h"
+#include "RotaryDeltaSolution.h"
+#include "MorganSCARASolution.h"
+
+#include <math.h>
+#include <memory>
+
+#include "easyunit/test.h"
+
+// distance from p to the line a b
+static float distance_to_line(const float p[], const float a[], const float u[])
+{
+    float ap[3], t = 0, d2 = 0;
+    for (int i = 0; i < 3; i++) {
+        ap[i] = p[i] - a[i];
+        t += ap[i] * u[i];
+    }
+    for (int i = 0; i < 3; i++) {
+        float d = ap[i] - u[i] * t;
+        d2 += d * d;
+    }
+    return sqrtf(d2);
+}
+
+// split the line a b the way Robot does for mm_max_kinematic_error, and return the furthest the arm gets from it
+// sampling the actuator path between the ends of each segment
+static float max_deviation(BaseSolution *arm, const float a[], const float b[], float max_error)
+{
+    float u[3], length = 0;
+    for (int i = 0; i < 3; i++) length += (b[i] - a[i]) * (b[i] - a[i]);
+    length = sqrtf(length);
+    for (int i = 0; i < 3; i++) u[i] = (b[i] - a[i]) / length;
+
+    float start[3] {a[0], a[1], a[2]}, end[3];
+    ActuatorCoordinates start_actuator, end_actuator;
+    arm->cartesian_to_actuator(start, start_actuator);
+
+    float worst = 0, done = 0, segment_length = length;
+    while(done < length - 0.0001F) {
+        float l = arm->segment_length(start, start_actuator, u, fminf(segment_length, length - done), max_error, end, end_actuator);
+        for (int j = 1; j < 20; ++j) {
+            ActuatorCoordinates act;
+            for (size_t i = 0; i < arm->get_actuator_count(); i++)
+                act[i] = start_actuator[i] + (end_actuator[i] - start_actuator[i]) * j / 20.0F;
+            float p[3];
+            arm->actuator_to_cartesian(act, p);
+            float d = distance_to_line(p, a, u);
+            if(d > worst) worst = d;
+        }
+        done += l;
+        for (int i = 0; i < 3; i++) start[i] = end[i];
+        start_actuator = end_actuator;
+        segment_length = l * 1.5F;
+    }
+    return worst;
+}
+
+// returns true if every line stayed within the error asked for
+static bool check_arm(BaseSolution *arm, const float lines[][6], int n)
+{
+    const float errors[] = {0.01F, 0.05F};
+    bool ok = true;
+    for(float err : errors) {
+        for (int i = 0; i < n; ++i) {
+            float d = max_deviation(arm, &lines[i][0], &lines[i][3], err);
+            // the midpoint is not quite the worst point of a segment, and FK rounds to 0.0001mm
+            if(d > err * 1.1F + 0.0002F) ok = false;
+        }
+    }
+    return ok;
+}
+
+TEST(SegmentLengthTest,linear_delta)
+{
+    const static char config[] = "arm_length 250\narm_radius 124\n";
+    test_kernel_setup_config(config, &config[sizeof(config)]);
+    std::unique_ptr<BaseSolution> arm(new LinearDeltaSolution(THEKERNEL->config));
+
+    // across the middle, out near the edge, and a pure Z move which needs no segments at all
+    const float lines[][6] = {{-10, 0, 10, 10, 0, 10}, {-100, -50, 0, 100, 50, 0}, {-80, 80, 0, 80, 80, 5}, {0, 0, 0, 0, 0, 100}};
+    ASSERT_TRUE(check_arm(arm.get(), lines, 4));
+    test_kernel_teardown();
+}
+
+TEST(SegmentLengthTest,rotary_delta)
+{
+    const static char config[] = "delta_e 131.636\n";
+    test_kernel_setup_config(config, &config[sizeof(config)]);
+    std::unique_ptr<BaseSolution> arm(new RotaryDeltaSolution(THEKERNEL->config));
+
+    const float lines[][6] = {{-10, 0, -20, 10, 0, -20}, {-80, -40, -40, 80, 40, -40}, {0, 0, -10, 0, 0, -60}};
+    ASSERT_TRUE(check_arm(arm.get(), lines, 3));
+    test_kernel_teardown();
+}
+
+TEST(SegmentLengthTest,morgan_scara)
+{
+    const static char config[] = "arm1_length 150\n";
+    test_kernel_setup_config(config, &config[sizeof(config)]);
+    std::unique_ptr<BaseSolution> arm(new MorganSCARASolution(THEKERNEL->config));
+
+    const float lines[][6] = {{0, 0, 0, 100, 100, 0}, {-50, 100, 0, 150, 100, 10}};
+    ASSERT_TRUE(check_arm(arm.get(), lines, 2));
+    test_kernel_teardown();
+}
@@ -0,0 +1,94 @@
+#include "Kernel.h"
+#include "Block.h"
+#include "Gcode.h"
+
+#include <stdio.h>
+#include <math.h>
+
+#include "easyunit/test.h"
+
+// setup a block of 10,000 steps the same way the planner does, 100mm at 100mm/sec with 1000mm/sec² acceleration
+static void setup_block(Block& block, float entry_speed, float exit_speed)
+{
+    THEKERNEL->acceleration_ticks_per_second= 1000;
+
+    block.clear();
+    block.steps[0]= 10000;
+    block.steps_event_count= 10000;
+    block.millimeters= 100.0F;
+    block.nominal_speed= 100.0F;
+    block.nominal_rate= 10000;
+    block.acceleration= 1000.0F;
+    block.rate_delta= (block.steps_event_count * block.acceleration) / (block.millimeters * THEKERNEL->acceleration_ticks_per_second);
+    block.calculate_trapezoid(entry_speed, exit_speed);
+    block.take(); // now it is executing
+}
+
+// A copy of the accelerate, cruise and decelerate branches of Stepper::trapezoid_generator_tick(), run over the rest of
+// the block, returns true if it got to the end. The motors stop themselves when they have done their steps so the last
+// tick may overshoot. The test kernel has no step ticker, actuators or planner so Stepper itself is not driven, these
+// tests check the trapezoid calculate_resume_trapezoid() gives it and not the hold and resume in Stepper
+static bool run_trapezoid(const Block& block, uint32_t stepped, float& last_rate)
+{
+    float rate= block.initial_rate;
+    float steps= stepped;
+    for (int ticks = 0; steps < block.steps_event_count && ticks < 100000; ++ticks) {
+        uint32_t completed= floorf(steps);
+        if(completed <= block.accelerate_until) {
+            rate += block.rate_delta;
+            if(rate > block.nominal_rate) rate= block.nominal_rate;
+        }else if(completed > block.decelerate_after) {
+            rate -= block.rate_delta;
+            if(rate < block.rate_delta * 1.5F) rate= block.rate_delta * 1.5F;
+            if(rate < block.final_rate) rate= block.final_rate;
+        }else{
+            rate= block.nominal_rate;
+        }
+        steps += rate / THEKERNEL->acceleration_ticks_per_second;
+        last_rate= rate;
+    }
+    return steps >= block.steps_event_count && steps < block.steps_event_count + last_rate / THEKERNEL->acceleration_ticks_per_second;
+}
+
+TEST(BlockTest,resume_trapezoid_mid_block)
+{
+    Block block;
+    setup_block(block, 0.0F, 50.0F);
+    ASSERT_EQUALS_V(5000, (int)block.final_rate);
+
+    block.calculate_resume_trapezoid(3000);
+
+    // we restart from rest and must get to the end of the block exactly
+    ASSERT_TRUE(block.initial_rate <= block.rate_delta + 1);
+    ASSERT_TRUE(block.accelerate_until >= 3000);
+    ASSERT_TRUE(block.decelerate_after >= block.accelerate_until);
+    ASSERT_TRUE(block.decelerate_after <= block.steps_event_count);
+
+    // there is plenty of room so the exit speed does not change
+    ASSERT_EQUALS_V(5000, (int)block.final_rate);
+    ASSERT_EQUALS_DELTA_V(50.0F, block.exit_speed, 0.001F);
+
+    float last_rate;
+    ASSERT_TRUE(run_trapezoid(block, 3000, last_rate));
+    ASSERT_EQUALS_DELTA_V(5000.0F, last_rate, block.rate_delta * 2);
+}
+
+TEST(BlockTest,resume_trapezoid_near_end_lowers_exit)
+{
+    Block block;
+    setup_block(block, 0.0F, 100.0F);
+
+    // only 50 steps left is not enough to get back up to 10,000 steps/sec
+    block.calculate_resume_trapezoid(9950);
+
+    ASSERT_TRUE(block.final_rate < 10000);
+    ASSERT_TRUE(block.exit_speed < 100.0F);
+    ASSERT_EQUALS_DELTA_V(block.final_rate * 100.0F / 10000.0F, block.exit_speed, 0.01F);
+
+    // accelerates all the way
+    ASSERT_TRUE(block.accelerate_until >= block.decelerate_after - 1);
+
+    float last_rate;
+    ASSERT_TRUE(run_trapezoid(block, 9950, last_rate));
+    ASSERT_TRUE(last_rate <= block.final_rate + block.rate_delta);
+}
@@ -0,0 +1,134 @@
+#include "QueueStats.h"
+#include "Planner.h"
+
+#include <deque>
+
+#include "easyunit/test.h"
+
+TEST(QueueStatsTest,underruns_and_min_depth)
+{
+    QueueStats qs;
+    ASSERT_TRUE(!qs.has_min_depth());
+
+    // filling from empty does not count until it has been full
+    qs.appended(1, false);
+    qs.appended(2, false);
+    ASSERT_TRUE(!qs.has_min_depth());
+    qs.appended(31, true);
+    qs.appended(20, false);
+    qs.appended(25, false);
+    ASSERT_EQUALS(20, (int)qs.get_min_depth());
+
+    // a short stop is an underrun
+    qs.ran_dry(1000000, false);
+    qs.restarted(1250000);
+    ASSERT_EQUALS(1, (int)qs.get_underruns());
+    ASSERT_EQUALS(250000, (int)qs.get_underrun_us());
+
+    // one waited for, or a gap before the next job, is not
+    qs.ran_dry(2000000, true);
+    qs.restarted(2100000);
+    qs.ran_dry(3000000, false);
+    qs.restarted(9000000);
+    ASSERT_EQUALS(1, (int)qs.get_underruns());
+
+    // nor is starting again when it never stopped
+    qs.restarted(9500000);
+    ASSERT_EQUALS(1, (int)qs.get_underruns());
+
+    // across the us counter wrapping
+    qs.ran_dry(0xFFFFFF00UL, false);
+    qs.restarted(0x100);
+    ASSERT_EQUALS(2, (int)qs.get_underruns());
+    ASSERT_EQUALS(250000 + 0x200, (int)qs.get_underrun_us());
+    ASSERT_EQUALS(250000, (int)qs.get_longest_underrun_us());
+
+    qs.reset();
+    ASSERT_EQUALS(0, (int)qs.get_underruns());
+    ASSERT_TRUE(!qs.has_min_depth());
+}
+
+struct sim_result_t {
+    QueueStats stats;
+    uint32_t total_us;
+};
+
+// Run n blocks of distance mm at rate mm/s through a queue of queue_size, with a new one available every period_us
+// except for a pause_us stall every pause_every blocks, as a throttled host or SD card. The blocks are planned with the
+// given slowdown time as append_block does and executed back to back, ignoring acceleration. Each line is read once the
+// previous one has been queued
+static sim_result_t simulate(int n, float distance, float rate, uint32_t period_us, int pause_every, uint32_t pause_us, float slowdown_time)
+{
+    const unsigned int queue_size= 32;
+    sim_result_t r;
+    std::deque<uint32_t> queue; // time to run each block, the front one is running
+    uint32_t now= 0, next_input= 0, block_end= 0;
+    bool running= false;
+    int sent= 0;
+    unsigned int previously_queued= 0;
+
+    while(sent < n || !queue.empty()) {
+        if(running && now >= block_end) {
+            queue.pop_front();
+            if(queue.empty()) {
+                running= false;
+                r.stats.ran_dry(now, false);
+            } else {
+                block_end += queue.front();
+            }
+        }
+
+        if(sent < n && now >= next_input && queue.size() < queue_size - 1) {
+            float planned= Planner::slowdown_rate(rate, distance, queue.size(), previously_queued, queue_size, slowdown_time);
+            previously_queued= queue.size();
+            queue.push_back(distance / planned * 1e6F);
+            r.stats.appended(queue.size(), queue.size() == queue_size - 1);
+            sent++;
+            next_input= now + period_us;
+            if(pause_every > 0 && sent % pause_every == 0) next_input += pause_us;
+            if(!running) {
+                running= true;
+                r.stats.restarted(now);
+                block_end= now + queue.front();
+            }
+        }
+        now += 10;
+    }
+    r.total_us= now;
+    return r;
+}
+
+TEST(QueueStatsTest,slowdown_with_a_throttled_input)
+{
+    // 0.2mm segments at 100mm/s take 2ms each
+
+    // never slowed past the min time, however few are queued, and less the more there are
+    ASSERT_EQUALS_DELTA(10.0F, Planner::slowdown_rate(100, 0.2F, 0, 0, 32, 0.02F), 0.001F);
+    ASSERT_EQUALS_DELTA(10.0F, Planner::slowdown_rate(100, 0.2F, 1, 1, 32, 0.02F), 0.001F);
+    ASSERT_EQUALS_DELTA(10.0F, Planner::slowdown_rate(100, 0.2F, 2, 2, 32, 0.02F), 0.001F);
+    ASSERT_TRUE(Planner::slowdown_rate(100, 0.2F, 8, 8, 32, 0.02F) > 10.0F);
+    ASSERT_EQUALS_DELTA(100.0F, Planner::slowdown_rate(100, 0.2F, 16, 16, 32, 0.02F), 0.001F);
+
+    // an input that keeps up never lets it run dry, it is only slowed while the queue first fills
+    sim_result_t fast= simulate(2000, 0.2F, 100, 500, 0, 0, 0.02F);
+    ASSERT_EQUALS(0, (int)fast.stats.get_underruns());
+    ASSERT_TRUE(fast.total_us < 2000 * 2000 * 1.05F);
+
+    // one line every 2.5ms, the queue runs dry every block without the slowdown
+    sim_result_t slow_off= simulate(2000, 0.2F, 100, 2500, 0, 0, 0);
+    sim_result_t slow_on= simulate(2000, 0.2F, 100, 2500, 0, 0, 0.02F);
+
+    // a host that keeps up but stalls for 100ms every 200 lines, longer than a full queue lasts
+    sim_result_t stall_off= simulate(2000, 0.2F, 100, 1000, 200, 100000, 0);
+    sim_result_t stall_on= simulate(2000, 0.2F, 100, 1000, 200, 100000, 0.02F);
+
+    ASSERT_TRUE(slow_off.stats.get_underruns() > 1000);
+    ASSERT_TRUE(slow_on.stats.get_underruns() < slow_off.stats.get_underruns() / 100);
+    ASSERT_TRUE(stall_off.stats.get_underruns() >= 9);
+    // a stall of an input that otherwise keeps up empties a full queue planned at full speed all the same, the slowdown
+    // only costs some time refilling it
+    ASSERT_EQUALS(stall_off.stats.get_underruns(), stall_on.stats.get_underruns());
+    ASSERT_TRUE(stall_on.total_us < stall_off.total_us * 1.1F);
+    // slowing down costs little time overall as it was waiting for the input anyway
+    ASSERT_TRUE(slow_on.total_us < slow_off.total_us * 1.02F);
+}